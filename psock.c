@@ -145,11 +145,15 @@ static char
 send_data(register struct psock *s)
 {
   if(s->state != STATE_DATA_SENT || uip_rexmit()) {
+#if UIP_LSO
+    uip_send_large(s->sendptr, s->sendlen);
+#else /* UIP_LSO */
     if(s->sendlen > uip_mss()) {
       uip_send(s->sendptr, uip_mss());
     } else {
       uip_send(s->sendptr, s->sendlen);
     }
+#endif /* UIP_LSO */
     s->state = STATE_DATA_SENT;
     return 1;
   }
@@ -160,10 +164,17 @@ static char
 data_acked(register struct psock *s)
 {
   if(s->state == STATE_DATA_SENT && uip_acked()) {
+#if UIP_LSO
+    if(s->sendlen > uip_acklen) {
+      s->sendlen -= uip_acklen;
+      s->sendptr += uip_acklen;
+    } else {
+#else /* UIP_LSO */
     if(s->sendlen > uip_mss()) {
       s->sendlen -= uip_mss();
       s->sendptr += uip_mss();
     } else {
+#endif /* UIP_LSO */
       s->sendptr += s->sendlen;
       s->sendlen = 0;
     }
@@ -120,6 +120,15 @@ struct icmpip_hdr {
 /* ICMP TIME-EXCEEDED. */
 #define ICMP_TE 11
 
+/* ICMP DESTINATION-UNREACHABLE, fragmentation needed. */
+#define ICMP_DEST_UNREACH 3
+#define ICMP_FRAG_NEEDED  4
+
+/* Flags and offset in the IP header, in host byte order. */
+#define IP_DF     0x4000
+#define IP_MF     0x2000
+#define IP_OFFSET 0x1fff
+
 /*
  * Pointer to the TCP/IP headers of the packet in the uip_buf buffer.
  */
@@ -212,14 +221,20 @@ ipaddr_maskcmp(u16_t *ipaddr, u16_t *netipaddr, u16_t *netmask)
 /*------------------------------------------------------------------------------*/
 /**
  * \internal
- * Send out an ICMP TIME-EXCEEDED message.
+ * Send out an ICMP error message, such as TIME-EXCEEDED, about the
+ * packet in the uip_buf buffer.
  *
  * This function replaces the packet in the uip_buf buffer with the
  * ICMP packet.
+ *
+ * \param type The ICMP type.
+ * \param code The ICMP code.
+ * \param mtu The MTU of the next hop for a fragmentation needed
+ * message, or zero.
  */
 /*------------------------------------------------------------------------------*/
 static void
-time_exceeded(void)
+icmp_error(u8_t type, u8_t code, u16_t mtu)
 {
   u16_t tmp16;
 
@@ -232,8 +247,10 @@ time_exceeded(void)
   memcpy(&(ICMPBUF->payload[0]), ICMPBUF, 28);
 
   /* Set the ICMP type and code. */
-  ICMPBUF->type = ICMP_TE;
-  ICMPBUF->icode = 0;
+  ICMPBUF->type = type;
+  ICMPBUF->icode = code;
+  ICMPBUF->id = 0;
+  ICMPBUF->seqno = htons(mtu);
 
   /* Calculate the ICMP checksum. */
   ICMPBUF->icmpchksum = 0;
@@ -252,8 +269,8 @@ time_exceeded(void)
   BUF->srcipaddr[0] = uip_hostaddr[0];
   BUF->srcipaddr[1] = uip_hostaddr[1];
 
-  /* The size of the ICMP time exceeded packet is 36 + the size of the
-     IP header (20) = 56. */
+  /* The size of the ICMP error packet is 36 + the size of the IP
+     header (20) = 56. */
   uip_len = 56;
   ICMPBUF->len[0] = 0;
   ICMPBUF->len[1] = uip_len;
@@ -338,6 +355,82 @@ find_netif(void)
   return defaultnetif;
 }
 /*------------------------------------------------------------------------------*/
+#if UIP_IP_FRAG
+/**
+ * \internal
+ * Split the IP packet in the uip_buf buffer into fragments that fit
+ * the MTU of a network interface and send them.
+ *
+ * Each fragment is built in place: its slice of the payload is moved
+ * down behind the IP header, so the payload is moved once in total
+ * rather than copied into a new buffer for every fragment. The
+ * contents of uip_buf are destroyed.
+ *
+ * \return UIP_FW_TOOLARGE if the packet may not or cannot be
+ * fragmented, otherwise the return value from the last call to the
+ * output function.
+ */
+/*------------------------------------------------------------------------------*/
+static u8_t
+fw_fragment(struct uip_fw_netif *netif)
+{
+  u8_t hdr[20];
+  u16_t off, n, maxn, total, offset;
+  u8_t ret;
+
+  offset = htons(BUF->ipoffset);
+  if((offset & IP_DF) != 0 ||
+     BUF->vhl != 0x45 ||
+     netif->mtu < 28) {
+    return UIP_FW_TOOLARGE;
+  }
+
+  memcpy(hdr, &uip_buf[UIP_LLH_LEN], 20);
+  total = uip_len - 20;
+  maxn = (netif->mtu - 20) & ~7;
+  ret = UIP_FW_OK;
+
+  for(off = 0; off < total; off += n) {
+    n = total - off;
+    if(n > maxn) {
+      n = maxn;
+    }
+    if(off > 0) {
+      memmove(&uip_buf[UIP_LLH_LEN + 20], &uip_buf[UIP_LLH_LEN + 20 + off], n);
+      memcpy(&uip_buf[UIP_LLH_LEN], hdr, 20);
+    }
+    BUF->len = htons(n + 20);
+    BUF->ipoffset = htons((offset & ~IP_OFFSET) |
+			  ((offset & IP_OFFSET) + (off >> 3)) |
+			  (off + n < total? IP_MF: 0));
+    BUF->ipchksum = 0;
+    BUF->ipchksum = ~(uip_ipchksum());
+    uip_len = n + 20;
+    ret = netif->output();
+  }
+  return ret;
+}
+#endif /* UIP_IP_FRAG */
+/*------------------------------------------------------------------------------*/
+/**
+ * \internal
+ * Send the packet in the uip_buf buffer on a network interface,
+ * fragmenting it if it exceeds the MTU of the interface.
+ */
+/*------------------------------------------------------------------------------*/
+static u8_t
+netif_output(struct uip_fw_netif *netif)
+{
+  if(netif->mtu != 0 && uip_len > netif->mtu) {
+#if UIP_IP_FRAG
+    return fw_fragment(netif);
+#else /* UIP_IP_FRAG */
+    return UIP_FW_TOOLARGE;
+#endif /* UIP_IP_FRAG */
+  }
+  return netif->output();
+}
+/*------------------------------------------------------------------------------*/
 /**
  * Output an IP packet on the correct network interface.
  *
@@ -350,6 +443,9 @@ find_netif(void)
  * \retval UIP_FW_NOROUTE No suitable network interface could be found
  * for the outbound packet, and the packet was not sent.
  *
+ * \retval UIP_FW_TOOLARGE The packet was larger than the MTU of the
+ * network interface and could not be fragmented.
+ *
  * \return The return value from the actual network interface output
  * function is passed unmodified as a return value.
  */
@@ -370,11 +466,16 @@ uip_fw_output(void)
   if(/*BUF->proto == UIP_PROTO_UDP &&*/
      BUF->destipaddr[0] == 0xffff &&
      BUF->destipaddr[1] == 0xffff) {
-    if(defaultnetif != NULL) {
+    /* Interfaces with a too small MTU are skipped, since
+       fragmenting would destroy the packet for the others. */
+    if(defaultnetif != NULL &&
+       (defaultnetif->mtu == 0 || uip_len <= defaultnetif->mtu)) {
       defaultnetif->output();
     }
     for(netif = netifs; netif != NULL; netif = netif->next) {
-      netif->output();
+      if(netif->mtu == 0 || uip_len <= netif->mtu) {
+	netif->output();
+      }
     }
     return UIP_FW_OK;
   }
@@ -390,7 +491,7 @@ uip_fw_output(void)
   }
   /* If we now have found a suitable network interface, we call its
      output function to send out the packet. */
-  return netif->output();
+  return netif_output(netif);
 }
 /*------------------------------------------------------------------------------*/
 /**
@@ -406,6 +507,7 @@ u8_t
 uip_fw_forward(void)
 {
   struct fwcache_entry *fw;
+  struct uip_fw_netif *netif;
 
   /* First check if the packet is destined for ourselves and return 0
      to indicate that the packet should be processed locally. */
@@ -456,7 +558,19 @@ uip_fw_forward(void)
     if(BUF->destipaddr[0] == 0xffff && BUF->destipaddr[1] == 0xffff) {
       return UIP_FW_LOCAL;
     }
-    time_exceeded();
+    icmp_error(ICMP_TE, 0, 0);
+  } else {
+    /* If the packet does not fit the outbound interface and may not
+       be fragmented, we tell the sender the MTU of the next hop so
+       that it can do path MTU discovery. */
+    netif = find_netif();
+    if(netif != NULL && netif->mtu != 0 && uip_len > netif->mtu &&
+#if UIP_IP_FRAG
+       (htons(BUF->ipoffset) & IP_DF) != 0 &&
+#endif /* UIP_IP_FRAG */
+       !(BUF->destipaddr[0] == 0xffff && BUF->destipaddr[1] == 0xffff)) {
+      icmp_error(ICMP_DEST_UNREACH, ICMP_FRAG_NEEDED, netif->mtu);
+    }
   }
   
   /* Decrement the TTL (time-to-live) value in the IP header */
@@ -59,6 +59,9 @@ struct uip_fw_netif {
   u8_t (* output)(void);
                               /**< A pointer to the function that
 				 sends a packet. */
+  u16_t mtu;                  /**< The largest IP packet that the
+				 interface can send, or zero if there
+				 is no limit other than uip_buf. */
 };
 
 /**
@@ -108,6 +111,18 @@ struct uip_fw_netif {
         do { (netif)->netmask[0] = ((u16_t *)(addr))[0]; \
              (netif)->netmask[1] = ((u16_t *)(addr))[1]; } while(0)
 
+/**
+ * Set the MTU of a network interface.
+ *
+ * Packets that are larger than the MTU are split into IP fragments
+ * if UIP_IP_FRAG is set, and are dropped otherwise.
+ *
+ * \param netif A pointer to the uip_fw_netif structure for the network interface.
+ * \param m The largest IP packet that the interface can send, or zero.
+ * \hideinitializer
+ */
+#define uip_fw_setmtu(netif, m) ((netif)->mtu = (m))
+
 void uip_fw_init(void);
 u8_t uip_fw_forward(void);
 u8_t uip_fw_output(void);
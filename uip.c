@@ -110,6 +110,11 @@ const uip_ipaddr_t uip_netmask =
 #else
 uip_ipaddr_t uip_hostaddr, uip_draddr, uip_netmask;
 #endif /* UIP_FIXEDADDR */
+#if UIP_DUAL_STACK
+uip_ipaddr_t uip_hostaddr4, uip_draddr4, uip_netmask4;
+				 /* The IPv4-mapped address, default
+				    router and netmask of the host. */
+#endif /* UIP_DUAL_STACK */
 
 static const uip_ipaddr_t all_ones_addr =
 #if UIP_CONF_IPV6
@@ -153,6 +158,12 @@ void *uip_urgdata;               /* The uip_urgdata pointer points to
 u16_t uip_urglen, uip_surglen;
 #endif /* UIP_URGDATA > 0 */
 
+#if UIP_RUNTIME_MTU
+u16_t uip_mtu = UIP_BUFSIZE - UIP_LLH_LEN;
+                             /* The largest IP packet that is sent,
+				set with uip_setmtu(). */
+#endif /* UIP_RUNTIME_MTU */
+
 u16_t uip_len, uip_slen;
                              /* The uip_len is either 8 or 16 bits,
 				depending on the maximum packet
@@ -164,17 +175,116 @@ u8_t uip_flags;     /* The uip_flags variable is used for
 struct uip_conn *uip_conn;   /* uip_conn always points to the current
 				connection. uip_connָǰ*/																	 
 
+#if UIP_CONN_POOL
+struct uip_conn *uip_conns;  /* The uip_conns pool holds all TCP
+				connections. The first uip_conns_num
+				of them have been taken into use. */
+unsigned int uip_conns_num;
+static unsigned int conns_limit;
+static struct uip_conn *freeconns; /* Closed connections that can be
+				      reused. */
+#if UIP_CONN_POOL_HASH_SIZE & (UIP_CONN_POOL_HASH_SIZE - 1)
+#error "UIP_CONN_POOL_HASH_SIZE must be a power of two"
+#endif
+static struct uip_conn *tcp_conn_hash[UIP_CONN_POOL_HASH_SIZE];
+				   /* Connections that are not closed,
+				      by local port, remote port and
+				      remote IP address. */
+static struct uip_conn *tcp_port_hash[UIP_CONN_POOL_HASH_SIZE];
+				   /* Actively opened connections that
+				      are not closed, by local port. */
+#define TCP_PORT_HASH(lport) \
+  (((lport) ^ ((lport) >> 8)) & (UIP_CONN_POOL_HASH_SIZE - 1))
+#else /* UIP_CONN_POOL */
 struct uip_conn uip_conns[UIP_CONNS];
                              /* The uip_conns array holds all TCP
 				connections. uip_conns鱣TCP*/
+#endif /* UIP_CONN_POOL */
 u16_t uip_listenports[UIP_LISTENPORTS];
                              /* The uip_listenports list all currently
 				listning ports. uip_listenportsбеǰҪĶ˿ں*/
 #if UIP_UDP
 struct uip_udp_conn *uip_udp_conn;
+#if UIP_CONN_POOL
+struct uip_udp_conn *uip_udp_conns;
+unsigned int uip_udp_conns_num;
+static unsigned int udp_conns_limit;
+static struct uip_udp_conn *freeudpconns;
+#else /* UIP_CONN_POOL */
 struct uip_udp_conn uip_udp_conns[UIP_UDP_CONNS];
+#endif /* UIP_CONN_POOL */
+#if UIP_UDP_HASH
+#if UIP_UDP_HASH_SIZE & (UIP_UDP_HASH_SIZE - 1)
+#error "UIP_UDP_HASH_SIZE must be a power of two"
+#endif
+/* The UDP connections by local port, and the connections that are
+   bound to a remote host by local port, remote port and remote IP
+   address. */
+static struct uip_udp_conn *udp_port_hash[UIP_UDP_HASH_SIZE];
+static struct uip_udp_conn *udp_conn_hash[UIP_UDP_HASH_SIZE];
+#endif /* UIP_UDP_HASH */
 #endif /* UIP_UDP */
 
+#if UIP_TCP_TIMER_WHEEL
+/* The kinds of timers that a connection can have running in the
+   timer wheel. */
+#define TW_NONE 0
+#define TW_RTX  1    /* conn->timer counts down to a retransmission. */
+#define TW_WAIT 2    /* conn->timer counts up to UIP_TIME_WAIT_TIMEOUT. */
+#define TW_KA   3    /* conn->katimer counts down to a keepalive probe. */
+#define TW_TLP  4    /* conn->timer counts down to a tail loss probe. */
+#define TW_POLL 5    /* Data in the send buffer is sent on the next
+			tick. */
+#define TW_PACE 6    /* Data held back by the pacer is sent when the
+			bucket has refilled. */
+
+#define TW_SLOT(tick) ((tick) & (UIP_TCP_TIMER_WHEEL_SIZE - 1))
+
+static struct uip_conn *wheel[UIP_TCP_TIMER_WHEEL_SIZE];
+static struct uip_conn *wheel_expired; /* Connections that have expired
+					  but not been processed yet. */
+static unsigned int wheel_ticks;
+static struct uip_conn *timed_conn;    /* The connection whose timer is
+					  re-armed when uip_process()
+					  returns. */
+#endif /* UIP_TCP_TIMER_WHEEL */
+
+#if UIP_READY_LIST
+static struct uip_conn *ready_head;   /* Connections that have data to
+					 send, in the order they were
+					 marked. */
+static struct uip_conn **ready_tailp; /* The next pointer of the last
+					 connection on the ready list. */
+static unsigned int ready_count;      /* Connections on the ready
+					 list. */
+static unsigned int ready_left;       /* Connections that
+					 uip_ready_next() may still
+					 return this round. */
+static u8_t ready_round;              /* Set while a round is under
+					 way. */
+#endif /* UIP_READY_LIST */
+
+#if UIP_TCP_KEEPALIVE || UIP_TCP_PERSIST
+static u8_t probe;           /* Set when the segment being sent is a
+				keepalive or window probe. */
+#endif /* UIP_TCP_KEEPALIVE || UIP_TCP_PERSIST */
+
+#if UIP_TCP_FASTPATH
+static struct uip_conn *last_conn; /* The connection of the last
+				      incoming segment. */
+#endif /* UIP_TCP_FASTPATH */
+
+#if UIP_TCP_TLP
+/* The probe timeout: two round-trip times, plus two ticks since the
+   data may have been sent just before a tick. conn->sa is the RTT
+   times 8. */
+#define TLP_PTO(conn) (((conn)->sa >> 2) + 2)
+/* The time after which data in transit is taken to be lost when the
+   remote host has reported that later data arrived: the RTT plus a
+   quarter of it, and at least a tick, for reordering. */
+#define RACK_LOST(conn) (((conn)->sa >> 3) + ((conn)->sa >> 5) + 1)
+#endif /* UIP_TCP_TLP */
+
 static u16_t ipid;           /* Ths ipid variable is an increasing
 				number that is used for the IP ID
 				field. ñһ*/
@@ -184,10 +294,10 @@ void uip_setipid(u16_t id) { ipid = id; }
 static u8_t iss[4];          /* The iss variable is used for the TCP
 				initial sequence number.ñTCPʼк */
 
-#if UIP_ACTIVE_OPEN
+#if UIP_ACTIVE_OPEN || UIP_UDP
 static u16_t lastport;       /* Keeps track of the last port used for
 				a new connection. һ˿ںµ*/
-#endif /* UIP_ACTIVE_OPEN */
+#endif /* UIP_ACTIVE_OPEN || UIP_UDP */
 
 /* Temporary variables. ʱ*/
 u8_t uip_acc32[4];
@@ -201,12 +311,19 @@ static u16_t tmp16;
 #define TCP_PSH 0x08
 #define TCP_ACK 0x10
 #define TCP_URG 0x20
+#define TCP_ECE 0x40
+#define TCP_CWR 0x80
 #define TCP_CTL 0x3f
 
 #define TCP_OPT_END     0   /* End of TCP options list TCPβ*/
 #define TCP_OPT_NOOP    1   /* "No-operation" TCP option */
 #define TCP_OPT_MSS     2   /* Maximum segment size TCP option TCPѡ ĶδС*/
 
+#define TCP_OPT_FASTOPEN 34 /* TCP Fast Open cookie option (RFC 7413) */
+
+#define TCP_OPT_FASTOPEN_COOKIE_LEN 8  /* Length of our cookies. */
+#define TCP_OPT_FASTOPEN_COOKIE_MAX 16 /* Longest cookie we accept. */
+
 #define TCP_OPT_MSS_LEN 4   /* Length of TCP MSS option. TCP MSSѡ󳤶*/
 																			  
 #define ICMP_ECHO_REPLY 0
@@ -222,13 +339,223 @@ static u16_t tmp16;
 #define ICMP6_OPTION_SOURCE_LINK_ADDRESS 1
 #define ICMP6_OPTION_TARGET_LINK_ADDRESS 2
 
+#if UIP_TCP_FASTOPEN
+/* The TCP Fast Open state of a connection in the SYN_SENT or
+   SYN_RCVD state. */
+#define TFO_COOKIE 1 /* A cookie is asked for or sent in the SYN or
+			SYNACK. */
+#define TFO_DATA   2 /* The application has been called with
+			UIP_CONNECTED during the handshake. */
+#define TFO_RCVD   3 /* Like TFO_DATA, for a connection that accepted
+			data in the SYN from a client. */
+
+static u8_t tfo_key[8];
+static u8_t tfo_keyset;      /* No cookies are handed out or accepted
+				until the key has been set. */
+static u16_t tfo_pending;    /* Connections in TFO_RCVD. */
+#if UIP_ACTIVE_OPEN
+/* The cookies we have got from servers. An entry with a zero length
+   is unused. */
+static struct {
+  uip_ipaddr_t ipaddr;
+  u8_t len;
+  u8_t cookie[TCP_OPT_FASTOPEN_COOKIE_MAX];
+} tfo_cache[UIP_TCP_FASTOPEN_CACHE];
+static u8_t tfo_cache_next;
+#endif /* UIP_ACTIVE_OPEN */
+#endif /* UIP_TCP_FASTOPEN */
+
+#if UIP_TCP_ECN
+#define ECN_OK  1   /* ECN was agreed on in the handshake. */
+#define ECN_ECE 2   /* ECE is set in the segments we send. */
+#define ECN_CWR 4   /* CWR is set in the next segment of new data. */
+
+#define IP_ECN_ECT0 0x02
+#define IP_ECN_CE   0x03
+#if UIP_CONF_IPV6
+#define IP_ECN(hdr) (((hdr)->tcflow >> 4) & 3)
+#else /* UIP_CONF_IPV6 */
+#define IP_ECN(hdr) ((hdr)->tos & 3)
+#endif /* UIP_CONF_IPV6 */
+
+static u8_t ecn_ect;        /* Set when the segment being sent is
+			       ECN-capable. */
+#endif /* UIP_TCP_ECN */
+
+#if UIP_PMTUD
+#if UIP_CONF_IPV6
+#error "Path MTU discovery is only supported for IPv4"
+#endif /* UIP_CONF_IPV6 */
+
+#define ICMP_DEST_UNREACH 3
+#define ICMP_FRAG_NEEDED  4
+
+#define IP_DF   0x40
+
+#define PMTU_MIN   68   /* The smallest MTU we believe in. */
+#define PMTU_ROUTE 0xff /* The time of an entry that never expires. */
+
+/* The IP and TCP headers of the segment that an ICMP error is about. */
+#define ICMPTCPBUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN + \
+                                                     UIP_IPH_LEN + 8])
+
+/* The path MTU table. Entries with a zero MTU are unused. */
+struct pmtu_entry {
+  uip_ipaddr_t ipaddr, netmask;
+  u16_t mtu;
+  u8_t time;
+};
+static struct pmtu_entry pmtu_table[UIP_PMTU_ENTRIES];
+#endif /* UIP_PMTUD */
+
+#if UIP_LSO
+u16_t uip_acklen;                /* The amount of data acknowledged by
+				    the last ACK. */
+#endif /* UIP_LSO */
+
+/* Data is split into several segments for a large send, and when the
+   data in transit is sent again after the MSS has been lowered. */
+#define TCP_SPLIT (UIP_LSO || UIP_PMTUD || UIP_RUNTIME_MTU)
+
+#if TCP_SPLIT
+static const u8_t *lso_data;     /* The data of a large send, or NULL. */
+static u16_t lso_left;           /* Bytes of the large send that are
+				    still to be put into segments. */
+static u8_t lso_hdr[UIP_TCPIP_HLEN]; /* Header template for the
+					segments of a large send. */
+void UIP_LSO_OUTPUT(void);
+#endif /* TCP_SPLIT */
+
+#if UIP_INPUT_BATCH
+static u8_t batch_verified;      /* Set when the TCP checksum of the
+				    segment in uip_buf has already been
+				    checked. */
+void UIP_BATCH_OUTPUT(void);
+#endif /* UIP_INPUT_BATCH */
+
+#if UIP_TX_BATCH
+__align(4) static u8_t tx_bufs[UIP_TX_BATCH_SIZE][UIP_BUFSIZE];
+static struct uip_frame tx_frames[UIP_TX_BATCH_SIZE];
+static u16_t tx_count;           /* The number of queued packets. */
+void UIP_TX_BATCH_OUTPUT(struct uip_frame *frames, u16_t n);
+#endif /* UIP_TX_BATCH */
+
+#if UIP_UDP_SENDMSG
+void UIP_UDP_SENDMSG_OUTPUT(void);
+#endif /* UIP_UDP_SENDMSG */
+
+#if UIP_IP_FRAG && UIP_CONF_IPV6
+#error "IP fragmentation is only supported for IPv4"
+#endif /* UIP_IP_FRAG && UIP_CONF_IPV6 */
+
+#if UIP_DUAL_STACK
+#if !UIP_CONF_IPV6
+#error "UIP_DUAL_STACK requires UIP_CONF_IPV6"
+#endif /* !UIP_CONF_IPV6 */
+
+/* The IPv4 header, for packets to and from IPv4 peers. */
+struct ip4_hdr {
+  u8_t vhl,
+    tos,
+    len[2],
+    ipid[2],
+    ipoffset[2],
+    ttl,
+    proto;
+  u16_t ipchksum;
+  u16_t srcipaddr[2],
+    destipaddr[2];
+};
+
+struct icmp4_hdr {
+  u8_t type, icode;
+  u16_t icmpchksum;
+};
+
+#define IP4_HLEN 20
+#define IP4BUF   ((struct ip4_hdr *)&uip_buf[UIP_LLH_LEN])
+#define ICMP4BUF ((struct icmp4_hdr *)&uip_buf[UIP_LLH_LEN + IP4_HLEN])
+
+/* Our source address towards a peer: the IPv4 address for IPv4-mapped
+   peers and the IPv6 address for the rest. */
+#define UIP_SRCADDR(dest) (uip_ipaddr_is4(dest)? uip_hostaddr4: uip_hostaddr)
+#else /* UIP_DUAL_STACK */
+#define UIP_SRCADDR(dest) uip_hostaddr
+#endif /* UIP_DUAL_STACK */
+
+#if UIP_IGMP
+#if UIP_CONF_IPV6
+#error "IGMP is only supported for IPv4"
+#endif /* UIP_CONF_IPV6 */
+
+#define IGMP_QUERY         0x11
+#define IGMP_V1_REPORT     0x12
+#define IGMP_V2_REPORT     0x16
+#define IGMP_V2_LEAVE      0x17
+#define IGMP_V3_REPORT     0x22
+
+/* IGMPv3 group record types. */
+#define IGMP_IS_EXCLUDE    2
+#define IGMP_TO_INCLUDE    3
+#define IGMP_TO_EXCLUDE    4
+
+#define IGMP_ROBUSTNESS    2   /* Times that a change is reported. */
+#define IGMP_UNSOLICITED   (10 / UIP_IGMP_TICK + 1) /* Ticks between
+						      them. */
+#define IGMP_V2_TIMEOUT    (2600 / UIP_IGMP_TICK) /* Ticks that an
+						    IGMPv2 query keeps
+						    us in IGMPv2 mode. */
+#define IGMP_IPH_LEN       24  /* IP header with a router alert
+				  option. */
+#define IGMP_V3_RECORDS    ((UIP_MTU - IGMP_IPH_LEN - 8) / 8) /* Group
+							 records that
+							 fit in a
+							 report. */
+
+struct igmp_hdr {
+  u8_t type, maxresp;
+  u16_t chksum;
+  uip_ipaddr_t group;
+};
+
+struct igmp_group {
+  uip_ipaddr_t addr;
+  u8_t refs;                   /* The number of joins, or zero while
+				  the group is being left. */
+  u8_t count;                  /* Reports of a change still to be
+				  sent. */
+  u16_t timer;                 /* Ticks until the next report, or
+				  zero. */
+};
+
+static struct igmp_group igmp_groups[UIP_IGMP_GROUPS];
+static u8_t igmp_filter[8];    /* A bit for each hash value of the
+				  joined groups. */
+static u16_t igmp_v2;          /* Ticks left in IGMPv2 mode. */
+static u16_t igmp_seed;
+
+#define IGMP_HASH(addr) ((((u8_t *)(addr))[2] ^ ((u8_t *)(addr))[3]) & 63)
+
+static const uip_ipaddr_t igmp_all_hosts = {HTONS(0xe000), HTONS(0x0001)};
+static const uip_ipaddr_t igmp_all_routers = {HTONS(0xe000), HTONS(0x0002)};
+static const uip_ipaddr_t igmp_v3_routers = {HTONS(0xe000), HTONS(0x0016)};
+
+/* Non-zero if a UDP connection takes the datagram in uip_buf, as far
+   as its multicast group is concerned. */
+#define UDP_GROUP_OK(conn) (((conn)->group[0] | (conn)->group[1]) == 0 || \
+			    uip_ipaddr_cmp(BUF->destipaddr, (conn)->group))
+#else /* UIP_IGMP */
+#define UDP_GROUP_OK(conn) 1
+#endif /* UIP_IGMP */
+
 
 /* Macros. */
 #define BUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
-#define FBUF ((struct uip_tcpip_hdr *)&uip_reassbuf[0])
 #define ICMPBUF ((struct uip_icmpip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UDPBUF ((struct uip_udpip_hdr *)&uip_buf[UIP_LLH_LEN])
 
+#define IP_MF   0x20
+
 
 #if UIP_STATISTICS == 1
 struct uip_stats uip_stat;
@@ -384,17 +711,68 @@ uip_init(void)		/*uipЭ
     uip_listenports[c] = 0;
   }
   /*ʼuip,״̬λر*/
+#if UIP_CONN_POOL
+  /* Connections are initialized when they are taken into use. */
+  uip_conns_num = 0;
+  freeconns = NULL;
+  memset(tcp_conn_hash, 0, sizeof(tcp_conn_hash));
+  memset(tcp_port_hash, 0, sizeof(tcp_port_hash));
+#else /* UIP_CONN_POOL */
   for(c = 0; c < UIP_CONNS; ++c) {
     uip_conns[c].tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_TIMER_WHEEL
+    uip_conns[c].twpprev = NULL;
+#endif /* UIP_TCP_TIMER_WHEEL */
+#if UIP_READY_LIST
+    uip_conns[c].rdpprev = NULL;
+#endif /* UIP_READY_LIST */
   }
-#if UIP_ACTIVE_OPEN
+#endif /* UIP_CONN_POOL */
+#if UIP_TCP_TIMER_WHEEL
+  memset(wheel, 0, sizeof(wheel));
+  wheel_expired = NULL;
+#endif /* UIP_TCP_TIMER_WHEEL */
+#if UIP_READY_LIST
+  ready_head = NULL;
+  ready_tailp = &ready_head;
+  ready_count = 0;
+  ready_round = 0;
+#endif /* UIP_READY_LIST */
+#if UIP_TCP_FASTPATH
+  last_conn = NULL;
+#endif /* UIP_TCP_FASTPATH */
+#if UIP_TX_BATCH
+  tx_count = 0;
+#endif /* UIP_TX_BATCH */
+#if UIP_IGMP
+  memset(igmp_groups, 0, sizeof(igmp_groups));
+  memset(igmp_filter, 0, sizeof(igmp_filter));
+  igmp_v2 = 0;
+#endif /* UIP_IGMP */
+#if UIP_TCP_FASTOPEN && UIP_ACTIVE_OPEN
+  memset(tfo_cache, 0, sizeof(tfo_cache));
+  tfo_cache_next = 0;
+#endif /* UIP_TCP_FASTOPEN && UIP_ACTIVE_OPEN */
+#if UIP_TCP_FASTOPEN
+  tfo_pending = 0;
+#endif /* UIP_TCP_FASTOPEN */
+#if UIP_ACTIVE_OPEN || UIP_UDP
   lastport = 1024;
 #endif /* UIP_ACTIVE_OPEN Ƿӹ*/
 
 #if UIP_UDP
+#if UIP_CONN_POOL
+  uip_udp_conns_num = 0;
+  freeudpconns = NULL;
+#else /* UIP_CONN_POOL */
   for(c = 0; c < UIP_UDP_CONNS; ++c) {
     uip_udp_conns[c].lport = 0;
   }
+#endif /* UIP_CONN_POOL */
+#if UIP_UDP_HASH
+  memset(udp_port_hash, 0, sizeof(udp_port_hash));
+  memset(udp_conn_hash, 0, sizeof(udp_conn_hash));
+#endif /* UIP_UDP_HASH */
 #endif /* UIP_UDP ǷudpܣҪʼuip_udp_conns*/
   
 
@@ -406,271 +784,2637 @@ uip_init(void)		/*uipЭ
 
 }
 /*---------------------------------------------------------------------------*/
-#if UIP_ACTIVE_OPEN
-struct uip_conn *
-uip_connect(uip_ipaddr_t *ripaddr, u16_t rport)
+#if UIP_CONN_POOL
+void
+uip_conn_pool_init(struct uip_conn *mem, unsigned int limit)
+{
+  uip_conns = mem;
+  uip_conns_num = 0;
+  conns_limit = limit;
+  freeconns = NULL;
+  memset(tcp_conn_hash, 0, sizeof(tcp_conn_hash));
+  memset(tcp_port_hash, 0, sizeof(tcp_port_hash));
+#if UIP_TCP_FASTOPEN
+  tfo_pending = 0;
+#endif /* UIP_TCP_FASTOPEN */
+}
+#endif /* UIP_CONN_POOL */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_TLP
+/* Check if the data in transit on a connection may be retransmitted
+   early. This is only done once, for the first transmission of the
+   data, and only if it comes before the retransmission timer. */
+static u8_t
+tlp_armed(struct uip_conn *conn)
+{
+  return conn->probed == 0 && conn->nrtx == 0 &&
+#if UIP_TCP_PERSIST
+    conn->persist == 0 &&
+#endif /* UIP_TCP_PERSIST */
+    (conn->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+    TLP_PTO(conn) < conn->rto;
+}
+/*---------------------------------------------------------------------------*/
+/* Check if the ACK in uip_buf acknowledges some, but not all, of the
+   data in transit on a connection. uIP does not ask for SACK, so this
+   is the only way an ACK can tell us that the remote host has
+   received more of the data since the last ACK. */
+static u8_t
+tcp_partial_ack(struct uip_conn *conn)
+{
+  unsigned long d;
+
+  d = ((((unsigned long)BUF->ackno[0] << 24) |
+	((unsigned long)BUF->ackno[1] << 16) |
+	((unsigned long)BUF->ackno[2] << 8) |
+	BUF->ackno[3]) -
+       (((unsigned long)conn->snd_nxt[0] << 24) |
+	((unsigned long)conn->snd_nxt[1] << 16) |
+	((unsigned long)conn->snd_nxt[2] << 8) |
+	conn->snd_nxt[3])) & 0xffffffffUL;
+  return d > 0 && d < conn->len;
+}
+#endif /* UIP_TCP_TLP */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_TIMER_WHEEL
+static void
+wheel_unlink(struct uip_conn *conn)
+{
+  if(conn->twpprev != NULL) {
+    *conn->twpprev = conn->twnext;
+    if(conn->twnext != NULL) {
+      conn->twnext->twpprev = conn->twpprev;
+    }
+    conn->twpprev = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+wheel_link(struct uip_conn **head, struct uip_conn *conn)
+{
+  conn->twnext = *head;
+  if(*head != NULL) {
+    (*head)->twpprev = &conn->twnext;
+  }
+  *head = conn;
+  conn->twpprev = head;
+}
+/*---------------------------------------------------------------------------*/
+/* Bring conn->timer up to date with the number of ticks that have
+   passed since the timer was armed, so that the rest of uIP sees the
+   same value as if uip_periodic() had been called on every tick. The
+   timer path passes tick = 1 since it runs as part of the current
+   tick. */
+static void
+wheel_sync(struct uip_conn *conn, u8_t tick)
+{
+  int left;
+
+  left = (int)(conn->twexpire - wheel_ticks) + tick;
+  if(left < 1) {
+    left = 1;
+  }
+  if(conn->twkind == TW_RTX) {
+    conn->timer = left - 1;
+#if UIP_TCP_TLP
+  } else if(conn->twkind == TW_TLP) {
+    conn->timer = left + conn->rto - TLP_PTO(conn);
+#endif /* UIP_TCP_TLP */
+  } else if(conn->twkind == TW_WAIT) {
+    conn->timer = UIP_TIME_WAIT_TIMEOUT - left;
+#if UIP_TCP_KEEPALIVE
+  } else if(conn->twkind == TW_KA) {
+    conn->katimer = left;
+#endif /* UIP_TCP_KEEPALIVE */
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Schedule the connection in the timer wheel according to its state
+   and the value of conn->timer. */
+static void
+wheel_update(struct uip_conn *conn)
+{
+  unsigned int ticks;
+
+  wheel_unlink(conn);
+  if(conn->tcpstateflags == UIP_TIME_WAIT ||
+     conn->tcpstateflags == UIP_FIN_WAIT_2) {
+    conn->twkind = TW_WAIT;
+    ticks = (u8_t)(UIP_TIME_WAIT_TIMEOUT - conn->timer);
+    if(ticks == 0) {
+      ticks = 256;
+    }
+#if UIP_PACING
+  } else if(conn->tcpstateflags != UIP_CLOSED && conn->pacer.held) {
+    /* The retransmission timer does not run while data is held
+       back. The pacer counts in clock ticks, which the wheel does not
+       know the length of, so the bucket is looked at on every tick
+       until it has refilled, as uip_periodic() would do. */
+    conn->twkind = TW_PACE;
+    ticks = 1;
+#endif /* UIP_PACING */
+  } else if(conn->tcpstateflags != UIP_CLOSED &&
+	    uip_outstanding(conn)) {
+    conn->twkind = TW_RTX;
+    ticks = conn->timer + 1;
+#if UIP_TCP_TLP
+    if(tlp_armed(conn) && conn->timer > conn->rto - TLP_PTO(conn)) {
+      /* The probe is due before the retransmission. */
+      conn->twkind = TW_TLP;
+      ticks = conn->timer - (conn->rto - TLP_PTO(conn));
+    }
+#endif /* UIP_TCP_TLP */
+#if UIP_TCP_TXBUF && !UIP_READY_LIST
+  } else if((conn->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+	    conn->txbuf != NULL && conn->txlen > 0) {
+    /* Without the ready list, the connection is only polled when its
+       timer expires, so data that has been written to the send
+       buffer is sent on the next tick. */
+    conn->twkind = TW_POLL;
+    ticks = 1;
+#endif /* UIP_TCP_TXBUF && !UIP_READY_LIST */
+#if UIP_TCP_KEEPALIVE
+  } else if((conn->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+	    conn->kaidle != 0) {
+    conn->twkind = TW_KA;
+    ticks = conn->katimer;
+#endif /* UIP_TCP_KEEPALIVE */
+  } else {
+    conn->twkind = TW_NONE;
+    return;
+  }
+  conn->twexpire = wheel_ticks + ticks;
+  wheel_link(&wheel[TW_SLOT(conn->twexpire)], conn);
+}
+/*---------------------------------------------------------------------------*/
+struct uip_conn *
+uip_wheel_expired(void)
+{
+  struct uip_conn *conn;
+
+  conn = wheel_expired;
+  if(conn != NULL) {
+    wheel_unlink(conn);
+  }
+  return conn;
+}
+#endif /* UIP_TCP_TIMER_WHEEL */
+/*---------------------------------------------------------------------------*/
+#if UIP_READY_LIST
+static void
+ready_unlink(struct uip_conn *conn)
+{
+  if(conn->rdpprev != NULL) {
+    *conn->rdpprev = conn->rdnext;
+    if(conn->rdnext != NULL) {
+      conn->rdnext->rdpprev = conn->rdpprev;
+    } else {
+      ready_tailp = conn->rdpprev;
+    }
+    conn->rdpprev = NULL;
+    --ready_count;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_conn_ready(struct uip_conn *conn)
+{
+  if(conn->rdpprev == NULL &&
+     conn->tcpstateflags != UIP_CLOSED) {
+    conn->rdnext = NULL;
+    conn->rdpprev = ready_tailp;
+    *ready_tailp = conn;
+    ready_tailp = &conn->rdnext;
+    ++ready_count;
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct uip_conn *
+uip_ready_next(void)
+{
+  struct uip_conn *conn;
+
+  if(!ready_round) {
+    /* A round covers the connections that are on the list when it
+       starts, up to the budget. */
+    ready_round = 1;
+    ready_left = ready_count < UIP_READY_BUDGET?
+      ready_count: UIP_READY_BUDGET;
+  }
+  conn = ready_head;
+  if(conn == NULL || ready_left == 0) {
+    /* End of this round. The connections that are left are first in
+       line on the next round. */
+    ready_round = 0;
+    return NULL;
+  }
+  --ready_left;
+  /* The connection is moved to the end of the list. It stays marked
+     until it has been polled, which only happens when it is
+     established and has no data in transit, so a connection that
+     cannot be polled yet comes up again on a later round. */
+  ready_unlink(conn);
+  uip_conn_ready(conn);
+  return conn;
+}
+#endif /* UIP_READY_LIST */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_KEEPALIVE
+void
+uip_keepalive(struct uip_conn *conn, u16_t idle, u16_t intvl, u8_t cnt)
+{
+  conn->kaidle = idle;
+  conn->kaintvl = intvl != 0? intvl: 1;
+  conn->kacnt = cnt;
+  conn->katimer = idle;
+  conn->kaprobes = 0;
+#if UIP_TCP_TIMER_WHEEL
+  /* Only reschedule connections that are not waiting for a
+     retransmission or TIME_WAIT timer, since conn->timer is only up
+     to date while the connection is being processed. */
+  if(conn->twkind == TW_NONE || conn->twkind == TW_KA) {
+    wheel_update(conn);
+  }
+#endif /* UIP_TCP_TIMER_WHEEL */
+}
+#endif /* UIP_TCP_KEEPALIVE */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_FASTOPEN
+void
+uip_fastopen_key(const u8_t *key)
+{
+  memcpy(tfo_key, key, sizeof(tfo_key));
+  tfo_keyset = 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Leave the Fast Open state of the handshake. */
+static void
+tfo_clear(struct uip_conn *conn)
+{
+  if(conn->fastopen == TFO_RCVD) {
+    --tfo_pending;
+  }
+  conn->fastopen = 0;
+}
+/*---------------------------------------------------------------------------*/
+#define TFO_ROTL(x, b) ((((x) << (b)) | ((x) >> (32 - (b)))) & 0xffffffffUL)
+#define TFO_ROUND do {							\
+    v0 = (v0 + v1) & 0xffffffffUL; v1 = TFO_ROTL(v1, 5); v1 ^= v0;	\
+    v0 = TFO_ROTL(v0, 16);						\
+    v2 = (v2 + v3) & 0xffffffffUL; v3 = TFO_ROTL(v3, 8); v3 ^= v2;	\
+    v0 = (v0 + v3) & 0xffffffffUL; v3 = TFO_ROTL(v3, 7); v3 ^= v0;	\
+    v2 = (v2 + v1) & 0xffffffffUL; v1 = TFO_ROTL(v1, 13); v1 ^= v2;	\
+    v2 = TFO_ROTL(v2, 16);						\
+  } while(0)
+#define TFO_GET32(p) ((unsigned long)(p)[0] |		\
+		      ((unsigned long)(p)[1] << 8) |	\
+		      ((unsigned long)(p)[2] << 16) |	\
+		      ((unsigned long)(p)[3] << 24))
+#define TFO_PUT32(p, v) do { (p)[0] = (v); (p)[1] = (v) >> 8;		\
+    (p)[2] = (v) >> 16; (p)[3] = (v) >> 24; } while(0)
+
+/* Compute the cookie for a client address. The cookie is the 64 bit
+   HalfSipHash-2-4 of the address under the secret key. */
+static void
+tfo_cookie(u8_t *cookie, void *addr)
+{
+  unsigned long v0, v1, v2, v3, k0, k1, m;
+  u8_t i, r;
+
+  k0 = TFO_GET32(tfo_key);
+  k1 = TFO_GET32(&tfo_key[4]);
+  v0 = k0;
+  v1 = k1 ^ 0xee;
+  v2 = k0 ^ 0x6c796765UL;
+  v3 = k1 ^ 0x74656462UL;
+
+  /* The address length is a multiple of four, so the last block only
+     holds the length. */
+  for(i = 0; i <= sizeof(uip_ipaddr_t); i += 4) {
+    if(i < sizeof(uip_ipaddr_t)) {
+      m = TFO_GET32((u8_t *)addr + i);
+    } else {
+      m = (unsigned long)sizeof(uip_ipaddr_t) << 24;
+    }
+    v3 ^= m;
+    for(r = 0; r < 2; ++r) {
+      TFO_ROUND;
+    }
+    v0 ^= m;
+  }
+
+  v2 ^= 0xee;
+  for(r = 0; r < 4; ++r) {
+    TFO_ROUND;
+  }
+  m = v1 ^ v3;
+  TFO_PUT32(cookie, m);
+  v1 ^= 0xdd;
+  for(r = 0; r < 4; ++r) {
+    TFO_ROUND;
+  }
+  m = v1 ^ v3;
+  TFO_PUT32(cookie + 4, m);
+}
+/*---------------------------------------------------------------------------*/
+/* Check the cookie in a TCP Fast Open option from a client. */
+static u8_t
+tfo_valid(u8_t *opt, void *addr)
+{
+  u8_t cookie[TCP_OPT_FASTOPEN_COOKIE_LEN];
+
+  if(opt[1] != 2 + TCP_OPT_FASTOPEN_COOKIE_LEN) {
+    return 0;
+  }
+  tfo_cookie(cookie, addr);
+  return memcmp(cookie, &opt[2], TCP_OPT_FASTOPEN_COOKIE_LEN) == 0;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_ACTIVE_OPEN
+static u8_t *
+tfo_cache_find(uip_ipaddr_t *addr, u8_t *len)
+{
+  u8_t i;
+
+  for(i = 0; i < UIP_TCP_FASTOPEN_CACHE; ++i) {
+    if(tfo_cache[i].len != 0 &&
+       uip_ipaddr_cmp(tfo_cache[i].ipaddr, *addr)) {
+      *len = tfo_cache[i].len;
+      return tfo_cache[i].cookie;
+    }
+  }
+  *len = 0;
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tfo_cache_store(uip_ipaddr_t *addr, u8_t *cookie, u8_t len)
+{
+  u8_t i;
+
+  for(i = 0; i < UIP_TCP_FASTOPEN_CACHE; ++i) {
+    if(tfo_cache[i].len != 0 &&
+       uip_ipaddr_cmp(tfo_cache[i].ipaddr, *addr)) {
+      break;
+    }
+  }
+  if(i == UIP_TCP_FASTOPEN_CACHE) {
+    i = tfo_cache_next;
+    if(++tfo_cache_next == UIP_TCP_FASTOPEN_CACHE) {
+      tfo_cache_next = 0;
+    }
+    uip_ipaddr_copy(tfo_cache[i].ipaddr, *addr);
+  }
+  tfo_cache[i].len = len;
+  memcpy(tfo_cache[i].cookie, cookie, len);
+}
+#endif /* UIP_ACTIVE_OPEN */
+/*---------------------------------------------------------------------------*/
+/* Put the TCP Fast Open option for the SYN or SYNACK of a connection
+   at opt. Returns the length of the option, padded to a multiple of
+   four with NOP options. */
+static u8_t
+tfo_options(struct uip_conn *conn, u8_t *opt)
+{
+  u8_t cookie[TCP_OPT_FASTOPEN_COOKIE_LEN];
+  u8_t *p, len, pad;
+
+  if(conn->tcpstateflags == UIP_SYN_RCVD) {
+    if(conn->fastopen != TFO_COOKIE) {
+      return 0;
+    }
+    tfo_cookie(cookie, conn->ripaddr);
+    p = cookie;
+    len = TCP_OPT_FASTOPEN_COOKIE_LEN;
+  } else {
+#if UIP_ACTIVE_OPEN
+    /* Our SYN carries the cookie we have for the server, or an empty
+       option that asks for one. */
+    p = tfo_cache_find(&conn->ripaddr, &len);
+#else /* UIP_ACTIVE_OPEN */
+    return 0;
+#endif /* UIP_ACTIVE_OPEN */
+  }
+
+  pad = (4 - ((2 + len) & 3)) & 3;
+  memset(opt, TCP_OPT_NOOP, pad);
+  opt[pad] = TCP_OPT_FASTOPEN;
+  opt[pad + 1] = 2 + len;
+  if(len > 0) {
+    memcpy(&opt[pad + 2], p, len);
+  }
+  return pad + 2 + len;
+}
+/*---------------------------------------------------------------------------*/
+/* Check if the incoming segment acknowledges the SYN of a connection
+   but not the data that was sent along with the SYN. If so, only the
+   SYN is taken off the outstanding data. */
+static u8_t
+tfo_synacked(struct uip_conn *conn)
+{
+  if(conn->len > 1 && (BUF->flags & TCP_ACK)) {
+    uip_add32(conn->snd_nxt, 1);
+    if(BUF->ackno[0] == uip_acc32[0] &&
+       BUF->ackno[1] == uip_acc32[1] &&
+       BUF->ackno[2] == uip_acc32[2] &&
+       BUF->ackno[3] == uip_acc32[3]) {
+      conn->snd_nxt[0] = uip_acc32[0];
+      conn->snd_nxt[1] = uip_acc32[1];
+      conn->snd_nxt[2] = uip_acc32[2];
+      conn->snd_nxt[3] = uip_acc32[3];
+      --(conn->len);
+      conn->timer = conn->rto;
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* UIP_TCP_FASTOPEN */
+#if UIP_DUAL_STACK
+/*---------------------------------------------------------------------------*/
+/* Take in an IPv4 packet. Echo requests are answered in place, and
+   TCP and UDP packets are turned into IPv6 packets between
+   IPv4-mapped addresses, so that the rest of uip_process() handles
+   them like any other IPv6 packet. The TCP and UDP checksums stay
+   valid, since the ::ffff:0:0/96 prefix adds nothing to the pseudo
+   header checksum. Returns 0 if the packet should be dropped, 1 if it
+   should be processed and 2 if an IPv4 reply is ready in uip_buf. */
+static u8_t
+ip4_input(void)
+{
+  u16_t len, src[2], dest[2];
+  u8_t tos, ttl, proto;
+
+  if(IP4BUF->vhl != 0x45) {
+    UIP_STAT(++uip_stat.ip.vhlerr);
+    UIP_LOG("ip: invalid version or header length.");
+    return 0;
+  }
+  len = (IP4BUF->len[0] << 8) + IP4BUF->len[1];
+  if(len > uip_len || len < IP4_HLEN) {
+    UIP_LOG("ip: packet shorter than reported in IP header.");
+    return 0;
+  }
+  uip_len = len;
+  if(uip_chksum((u16_t *)IP4BUF, IP4_HLEN) != 0xffff) {
+    UIP_STAT(++uip_stat.ip.chkerr);
+    UIP_LOG("ip: bad checksum.");
+    return 0;
+  }
+  if((IP4BUF->ipoffset[0] & 0x3f) != 0 || IP4BUF->ipoffset[1] != 0) {
+    UIP_STAT(++uip_stat.ip.fragerr);
+    UIP_LOG("ip: fragment dropped.");
+    return 0;
+  }
+  if(IP4BUF->destipaddr[0] != uip_hostaddr4[6] ||
+     IP4BUF->destipaddr[1] != uip_hostaddr4[7]) {
+#if UIP_BROADCAST
+    if(IP4BUF->proto != UIP_PROTO_UDP ||
+       IP4BUF->destipaddr[0] != 0xffff ||
+       IP4BUF->destipaddr[1] != 0xffff) {
+      return 0;
+    }
+#else /* UIP_BROADCAST */
+    return 0;
+#endif /* UIP_BROADCAST */
+  }
+
+  if(IP4BUF->proto == UIP_PROTO_ICMP) {
+    UIP_STAT(++uip_stat.icmp.recv);
+    if(ICMP4BUF->type != ICMP_ECHO) {
+      UIP_STAT(++uip_stat.icmp.typeerr);
+      UIP_LOG("icmp: not icmp echo.");
+      return 0;
+    }
+    ICMP4BUF->type = ICMP_ECHO_REPLY;
+    if(ICMP4BUF->icmpchksum >= HTONS(0xffff - (ICMP_ECHO << 8))) {
+      ICMP4BUF->icmpchksum += HTONS(ICMP_ECHO << 8) + 1;
+    } else {
+      ICMP4BUF->icmpchksum += HTONS(ICMP_ECHO << 8);
+    }
+    IP4BUF->destipaddr[0] = IP4BUF->srcipaddr[0];
+    IP4BUF->destipaddr[1] = IP4BUF->srcipaddr[1];
+    IP4BUF->srcipaddr[0] = uip_hostaddr4[6];
+    IP4BUF->srcipaddr[1] = uip_hostaddr4[7];
+    IP4BUF->ttl = UIP_TTL;
+    IP4BUF->ipchksum = 0;
+    IP4BUF->ipchksum = ~(uip_chksum((u16_t *)IP4BUF, IP4_HLEN));
+    UIP_STAT(++uip_stat.icmp.sent);
+    return 2;
+  }
+  if(IP4BUF->proto != UIP_PROTO_TCP && IP4BUF->proto != UIP_PROTO_UDP) {
+    UIP_STAT(++uip_stat.ip.protoerr);
+    UIP_LOG("ip: neither tcp nor icmp.");
+    return 0;
+  }
+  if(UIP_LLH_LEN + len + UIP_IPH_LEN - IP4_HLEN > UIP_BUFSIZE) {
+    return 0;
+  }
+
+  tos = IP4BUF->tos;
+  ttl = IP4BUF->ttl;
+  proto = IP4BUF->proto;
+  src[0] = IP4BUF->srcipaddr[0];
+  src[1] = IP4BUF->srcipaddr[1];
+  dest[0] = IP4BUF->destipaddr[0];
+  dest[1] = IP4BUF->destipaddr[1];
+  len -= IP4_HLEN;
+  memmove(&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN],
+	  &uip_buf[UIP_LLH_LEN + IP4_HLEN], len);
+  BUF->vtc = 0x60 | (tos >> 4);
+  BUF->tcflow = tos << 4;
+  BUF->flow = 0;
+  BUF->len[0] = len >> 8;
+  BUF->len[1] = len & 0xff;
+  BUF->proto = proto;
+  BUF->ttl = ttl;
+  memset(BUF->srcipaddr, 0, 10);
+  memset(BUF->destipaddr, 0, 10);
+  BUF->srcipaddr[5] = BUF->destipaddr[5] = 0xffff;
+  BUF->srcipaddr[6] = src[0];
+  BUF->srcipaddr[7] = src[1];
+  BUF->destipaddr[6] = dest[0];
+  BUF->destipaddr[7] = dest[1];
+  uip_len = len + UIP_IPH_LEN;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Turn the IPv6 packet in uip_buf into an IPv4 packet if it is
+   addressed to an IPv4-mapped address. ICMPv6 messages have no IPv4
+   counterpart and are dropped by setting uip_len to zero. */
+static void
+ip4_output(void)
+{
+  u16_t src[2], dest[2];
+  u8_t tos, ttl, proto;
+
+  if((BUF->vtc & 0xf0) != 0x60 || !uip_ipaddr_is4(BUF->destipaddr)) {
+    return;
+  }
+  if(BUF->proto != UIP_PROTO_TCP && BUF->proto != UIP_PROTO_UDP) {
+    uip_len = 0;
+    return;
+  }
+
+  tos = (BUF->vtc << 4) | (BUF->tcflow >> 4);
+  ttl = BUF->ttl;
+  proto = BUF->proto;
+  src[0] = BUF->srcipaddr[6];
+  src[1] = BUF->srcipaddr[7];
+  dest[0] = BUF->destipaddr[6];
+  dest[1] = BUF->destipaddr[7];
+  uip_len -= UIP_IPH_LEN - IP4_HLEN;
+  memmove(&uip_buf[UIP_LLH_LEN + IP4_HLEN],
+	  &uip_buf[UIP_LLH_LEN + UIP_IPH_LEN], uip_len - IP4_HLEN);
+
+  IP4BUF->vhl = 0x45;
+  IP4BUF->tos = tos;
+  IP4BUF->len[0] = uip_len >> 8;
+  IP4BUF->len[1] = uip_len & 0xff;
+  ++ipid;
+  IP4BUF->ipid[0] = ipid >> 8;
+  IP4BUF->ipid[1] = ipid & 0xff;
+  IP4BUF->ipoffset[0] = IP4BUF->ipoffset[1] = 0;
+  IP4BUF->ttl = ttl;
+  IP4BUF->proto = proto;
+  IP4BUF->srcipaddr[0] = src[0];
+  IP4BUF->srcipaddr[1] = src[1];
+  IP4BUF->destipaddr[0] = dest[0];
+  IP4BUF->destipaddr[1] = dest[1];
+  IP4BUF->ipchksum = 0;
+  IP4BUF->ipchksum = ~(uip_chksum((u16_t *)IP4BUF, IP4_HLEN));
+}
+#endif /* UIP_DUAL_STACK */
+/*---------------------------------------------------------------------------*/
+#if UIP_PMTUD || UIP_RUNTIME_MTU
+/* Lower the MSS of a connection. The data in transit keeps its
+   length, since the application takes UIP_ACKDATA to mean that all
+   of it has arrived; if it is larger than the new MSS, it is sent
+   again in several segments. */
+static void
+mss_lower(struct uip_conn *conn, u16_t mss)
+{
+  if(conn->initialmss > mss) {
+    conn->initialmss = mss;
+  }
+  if(conn->mss > mss) {
+    conn->mss = mss;
+  }
+}
+#endif /* UIP_PMTUD || UIP_RUNTIME_MTU */
+/*---------------------------------------------------------------------------*/
+#if UIP_RUNTIME_MTU
+void
+uip_setmtu(u16_t mtu)
+{
+  struct uip_conn *conn;
+
+  if(mtu > UIP_BUFSIZE - UIP_LLH_LEN) {
+    mtu = UIP_BUFSIZE - UIP_LLH_LEN;
+  }
+  if(mtu < UIP_TCPIP_HLEN + 8) {
+    mtu = UIP_TCPIP_HLEN + 8;
+  }
+  uip_mtu = mtu;
+  for(conn = &uip_conns[0]; conn < &uip_conns[UIP_CONNS]; ++conn) {
+    if(conn->tcpstateflags != UIP_CLOSED) {
+      mss_lower(conn, UIP_TCP_MSS);
+    }
+  }
+}
+#endif /* UIP_RUNTIME_MTU */
+/*---------------------------------------------------------------------------*/
+#if UIP_PMTUD
+/* Find the entry of the path MTU table for a network. If there is
+   none, an unused entry or the oldest learned entry is returned. */
+static struct pmtu_entry *
+pmtu_slot(uip_ipaddr_t *addr, const uip_ipaddr_t *netmask)
+{
+  struct pmtu_entry *e, *old;
+
+  for(e = &pmtu_table[0]; e < &pmtu_table[UIP_PMTU_ENTRIES]; ++e) {
+    if(e->mtu != 0 &&
+       uip_ipaddr_cmp(e->ipaddr, *addr) &&
+       uip_ipaddr_cmp(e->netmask, *netmask)) {
+      return e;
+    }
+  }
+  old = NULL;
+  for(e = &pmtu_table[0]; e < &pmtu_table[UIP_PMTU_ENTRIES]; ++e) {
+    if(e->mtu == 0) {
+      return e;
+    }
+    if(e->time != PMTU_ROUTE &&
+       (old == NULL || e->time > old->time)) {
+      old = e;
+    }
+  }
+  return old;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_pmtu_route(uip_ipaddr_t *addr, uip_ipaddr_t *netmask, u16_t mtu)
+{
+  struct pmtu_entry *e;
+
+  e = pmtu_slot(addr, netmask);
+  if(e != NULL) {
+    uip_ipaddr_copy(e->ipaddr, *addr);
+    uip_ipaddr_copy(e->netmask, *netmask);
+    e->mtu = (mtu != 0 && mtu < PMTU_MIN)? PMTU_MIN: mtu;
+    e->time = PMTU_ROUTE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_pmtu_timer(void)
+{
+  struct pmtu_entry *e;
+
+  for(e = &pmtu_table[0]; e < &pmtu_table[UIP_PMTU_ENTRIES]; ++e) {
+    if(e->mtu != 0 && e->time != PMTU_ROUTE &&
+       ++(e->time) >= UIP_PMTU_MAXAGE) {
+      e->mtu = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Return the largest MSS that may be used towards a host. */
+static u16_t
+pmtu_mss(uip_ipaddr_t *addr)
+{
+  struct pmtu_entry *e;
+  u16_t mss;
+
+  mss = UIP_TCP_MSS;
+  for(e = &pmtu_table[0]; e < &pmtu_table[UIP_PMTU_ENTRIES]; ++e) {
+    if(e->mtu != 0 &&
+       uip_ipaddr_maskcmp(*addr, e->ipaddr, e->netmask) &&
+       e->mtu - UIP_IPTCPH_LEN < mss) {
+      mss = e->mtu - UIP_IPTCPH_LEN;
+    }
+  }
+  return mss;
+}
+/*---------------------------------------------------------------------------*/
+/* Remember the path MTU to a host and apply it to all connections to
+   the host. */
+static void
+pmtu_learn(uip_ipaddr_t *addr, u16_t mtu)
+{
+  struct pmtu_entry *e;
+  struct uip_conn *conn;
+
+  e = pmtu_slot(addr, &all_ones_addr);
+  if(e != NULL && (e->mtu == 0 || e->time != PMTU_ROUTE)) {
+    uip_ipaddr_copy(e->ipaddr, *addr);
+    uip_ipaddr_copy(e->netmask, all_ones_addr);
+    e->mtu = mtu;
+    e->time = 0;
+  }
+  for(conn = &uip_conns[0]; conn < &uip_conns[UIP_CONNS]; ++conn) {
+    if(conn->tcpstateflags != UIP_CLOSED &&
+       uip_ipaddr_cmp(conn->ripaddr, *addr)) {
+      mss_lower(conn, mtu - UIP_IPTCPH_LEN);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Guess the MTU of the next hop from the length of the packet that
+   did not fit, for routers that do not report it (RFC 1191). */
+static u16_t
+pmtu_plateau(u16_t len)
+{
+  static const u16_t plateaus[] = {4352, 2002, 1492, 1006, 508, 296};
+
+  for(c = 0; c < sizeof(plateaus) / sizeof(plateaus[0]); ++c) {
+    if(plateaus[c] < len) {
+      return plateaus[c];
+    }
+  }
+  return PMTU_MIN;
+}
+#endif /* UIP_PMTUD */
+#if TCP_SPLIT
+/*---------------------------------------------------------------------------*/
+/* Send out the segments of a large send. The first segment is in
+   uip_buf with all headers filled in, and its headers are used as the
+   template for the rest. All segments but the last are sent with
+   UIP_LSO_OUTPUT(); the last one is left in uip_buf. The template is
+   kept on the side since the output function may overwrite the
+   headers in uip_buf (e.g., with an ARP request). */
+static void
+lso_output(u16_t mss)
+{
+  u16_t len;
+
+  len = uip_len - UIP_TCPIP_HLEN;
+  memcpy(lso_hdr, BUF, UIP_TCPIP_HLEN);
+#if UIP_TCP_ECN
+  /* Only the first segment carries CWR. */
+  ((struct uip_tcpip_hdr *)lso_hdr)->flags &= ~TCP_CWR;
+#endif /* UIP_TCP_ECN */
+  while(lso_left > 0) {
+#if UIP_DUAL_STACK
+    ip4_output();
+#endif /* UIP_DUAL_STACK */
+    UIP_LSO_OUTPUT();
+    UIP_STAT(++uip_stat.tcp.sent);
+    UIP_STAT(++uip_stat.ip.sent);
+
+    /* Build the next segment from the template. */
+    uip_add32(((struct uip_tcpip_hdr *)lso_hdr)->seqno, len);
+    memcpy(((struct uip_tcpip_hdr *)lso_hdr)->seqno, uip_acc32, 4);
+    memcpy(BUF, lso_hdr, UIP_TCPIP_HLEN);
+
+    len = lso_left > mss? mss: lso_left;
+    memcpy(&uip_buf[UIP_LLH_LEN + UIP_TCPIP_HLEN], lso_data, len);
+    lso_data += len;
+    lso_left -= len;
+    uip_len = len + UIP_TCPIP_HLEN;
+
+#if UIP_CONF_IPV6
+    BUF->len[0] = ((uip_len - UIP_IPH_LEN) >> 8);
+    BUF->len[1] = ((uip_len - UIP_IPH_LEN) & 0xff);
+#else /* UIP_CONF_IPV6 */
+    BUF->len[0] = (uip_len >> 8);
+    BUF->len[1] = (uip_len & 0xff);
+    ++ipid;
+    BUF->ipid[0] = ipid >> 8;
+    BUF->ipid[1] = ipid & 0xff;
+    BUF->ipchksum = 0;
+    BUF->ipchksum = ~(uip_ipchksum());
+#endif /* UIP_CONF_IPV6 */
+    BUF->tcpchksum = 0;
+    BUF->tcpchksum = ~(uip_tcpchksum());
+  }
+  uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_TCPIP_HLEN];
+}
+#endif /* TCP_SPLIT */
+#if UIP_TCP_RXBUF
+/*---------------------------------------------------------------------------*/
+/* Store incoming data in the receive ring of a connection. Returns
+   the number of bytes that fit. */
+static u16_t
+rxbuf_put(register struct uip_conn *conn, const u8_t *data, u16_t len)
+{
+  u16_t end, n;
+
+  if(len > conn->rxsize - conn->rxlen) {
+    len = conn->rxsize - conn->rxlen;
+  }
+  end = conn->rxstart + conn->rxlen;
+  if(end >= conn->rxsize) {
+    end -= conn->rxsize;
+  }
+  n = conn->rxsize - end;
+  if(n > len) {
+    n = len;
+  }
+  memcpy(&conn->rxbuf[end], data, n);
+  memcpy(conn->rxbuf, data + n, len - n);
+  conn->rxlen += len;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+/* Check if reading from the receive ring has opened the window far
+   enough to tell the remote host about it. Small updates are not
+   sent, to avoid the silly window syndrome (RFC 1122). */
+static u8_t
+rxbuf_wndupdate(register struct uip_conn *conn)
+{
+  u16_t n;
+
+  if(conn->rxbuf == NULL ||
+     (conn->tcpstateflags & UIP_STOPPED)) {
+    return 0;
+  }
+  n = conn->rxsize / 2;
+  if(n > conn->initialmss) {
+    n = conn->initialmss;
+  }
+  return conn->rxsize - conn->rxlen >= conn->rxwnd + n;
+}
+#endif /* UIP_TCP_RXBUF */
+#if UIP_TCP_TXBUF
+/*---------------------------------------------------------------------------*/
+/* Copy data from the head of the send ring of a connection. */
+static void
+txbuf_get(register struct uip_conn *conn, u8_t *dst, u16_t len)
+{
+  u16_t n;
+
+  n = conn->txsize - conn->txstart;
+  if(n > len) {
+    n = len;
+  }
+  memcpy(dst, &conn->txbuf[conn->txstart], n);
+  memcpy(dst + n, conn->txbuf, len - n);
+}
+#endif /* UIP_TCP_TXBUF */
+#if UIP_PACING
+/*---------------------------------------------------------------------------*/
+static void
+pace_init(struct uip_pacer *p, u16_t rate, u16_t burst)
+{
+  if(burst > 32767) {
+    burst = 32767;
+  }
+  p->rate = rate;
+  p->burst = burst;
+  p->tokens = burst;
+  p->stamp = clock_time();
+  p->held = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Add the tokens that have been earned since the bucket was last
+   refilled. Returns non-zero if something may be sent. */
+static u8_t
+pace_refill(struct uip_pacer *p)
+{
+  clock_time_t now, elapsed;
+
+  now = clock_time();
+  elapsed = now - p->stamp;
+  p->stamp = now;
+  if(elapsed > (clock_time_t)(((long)p->burst - p->tokens) / p->rate)) {
+    p->tokens = p->burst;
+  } else {
+    p->tokens += elapsed * p->rate;
+  }
+  return p->tokens > 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Take the tokens for len bytes. The bucket may go into debt, which
+   is paid back before anything more is sent. */
+static void
+pace_take(struct uip_pacer *p, u16_t len)
+{
+  if(p->tokens < (long)len - 32767) {
+    p->tokens = -32767;
+  } else {
+    p->tokens -= len;
+  }
+}
+#endif /* UIP_PACING */
+#if UIP_TCP_ECN
+/*---------------------------------------------------------------------------*/
+/* Update the congestion window of a connection for an ACK of its data
+   in transit. An ACK with ECE shrinks the window to half of the data
+   that was in transit (with DCTCP, by half the fraction of marked
+   segments) and makes us send CWR. Any other ACK grows the window by
+   one segment. */
+static void
+ecn_acked(register struct uip_conn *conn)
+{
+  u16_t w;
+
+  if(!(conn->ecn & ECN_OK)) {
+    return;
+  }
+#if UIP_TCP_ECN_DCTCP
+  /* alpha = (1 - g) * alpha + g * F, with g = 1/16 and F = 1 if the
+     data was marked. */
+  conn->alpha -= conn->alpha >> 4;
+  if(BUF->flags & TCP_ECE) {
+    conn->alpha += 1024 >> 4;
+  }
+#endif /* UIP_TCP_ECN_DCTCP */
+  if(BUF->flags & TCP_ECE) {
+    w = conn->len < conn->cwnd? conn->len: conn->cwnd;
+#if UIP_TCP_ECN_DCTCP
+    w -= ((unsigned long)w * conn->alpha) >> 11;
+#else /* UIP_TCP_ECN_DCTCP */
+    w >>= 1;
+#endif /* UIP_TCP_ECN_DCTCP */
+    conn->cwnd = w > conn->initialmss? w: conn->initialmss;
+    conn->ecn |= ECN_CWR;
+  } else if(conn->cwnd < 0xffff - conn->initialmss) {
+    conn->cwnd += conn->initialmss;
+  } else {
+    conn->cwnd = 0xffff;
+  }
+}
+#endif /* UIP_TCP_ECN */
+/*---------------------------------------------------------------------------*/
+/* Update a connection for an ACK of all of its data in transit. The
+   new snd_nxt must be in uip_acc32. */
+static void
+tcp_acked(register struct uip_conn *conn)
+{
+  /* Update sequence number. */
+  conn->snd_nxt[0] = uip_acc32[0];
+  conn->snd_nxt[1] = uip_acc32[1];
+  conn->snd_nxt[2] = uip_acc32[2];
+  conn->snd_nxt[3] = uip_acc32[3];
+
+  /* Do RTT estimation, unless we have done retransmissions. A tail
+     loss probe or a RACK retransmission does not count in nrtx, but
+     the ACK may be for either copy of the data all the same. */
+#if UIP_TCP_TLP
+  if(conn->nrtx == 0 && !conn->probed) {
+#else /* UIP_TCP_TLP */
+  if(conn->nrtx == 0) {
+#endif /* UIP_TCP_TLP */
+    signed char m;
+    m = conn->rto - conn->timer;
+    /* This is taken directly from VJs original code in his paper */
+    m = m - (conn->sa >> 3);
+    conn->sa += m;
+    if(m < 0) {
+      m = -m;
+    }
+    m = m - (conn->sv >> 2);
+    conn->sv += m;
+    conn->rto = (conn->sa >> 3) + conn->sv;
+  }
+  /* Set the acknowledged flag. */
+  uip_flags = UIP_ACKDATA;
+  /* Reset the retransmission timer. */
+  conn->timer = conn->rto;
+#if UIP_TCP_TLP
+  conn->probed = 0;
+#endif /* UIP_TCP_TLP */
+
+#if UIP_TCP_ECN
+  ecn_acked(conn);
+#endif /* UIP_TCP_ECN */
+
+  /* Reset length of outstanding data. */
+#if UIP_LSO
+  uip_acklen = conn->len;
+#endif /* UIP_LSO */
+#if UIP_TCP_TXBUF
+  if(conn->txbuf != NULL &&
+     (conn->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+    /* The acknowledged data is removed from the send ring. */
+    conn->txstart += conn->len;
+    if(conn->txstart >= conn->txsize) {
+      conn->txstart -= conn->txsize;
+    }
+    conn->txlen -= conn->len;
+  }
+#endif /* UIP_TCP_TXBUF */
+  conn->len = 0;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_CONN_POOL
+static u16_t
+tcp_conn_hashval(u16_t lport, u16_t rport, u16_t *ipaddr)
+{
+  u16_t h;
+  u8_t i;
+
+  h = lport ^ rport;
+  for(i = 0; i < sizeof(uip_ipaddr_t) / 2; ++i) {
+    h ^= ipaddr[i];
+  }
+  return (h ^ (h >> 8)) & (UIP_CONN_POOL_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Put a connection that has been given its ports and remote address
+   into the hash tables. Only actively opened connections go into the
+   port hash table, so that the connections accepted on a listening
+   port do not all end up in one bucket. */
+static void
+tcp_hash(struct uip_conn *conn, u8_t active)
+{
+  struct uip_conn **head;
+
+  head = &tcp_conn_hash[tcp_conn_hashval(conn->lport, conn->rport,
+					 (u16_t *)conn->ripaddr)];
+  conn->hnext = *head;
+  *head = conn;
+  if(active) {
+    head = &tcp_port_hash[TCP_PORT_HASH(conn->lport)];
+    conn->pnext = *head;
+    *head = conn;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_unhash(struct uip_conn *conn)
+{
+  struct uip_conn **p;
+
+  for(p = &tcp_conn_hash[tcp_conn_hashval(conn->lport, conn->rport,
+					  (u16_t *)conn->ripaddr)];
+      *p != NULL; p = &(*p)->hnext) {
+    if(*p == conn) {
+      *p = conn->hnext;
+      break;
+    }
+  }
+  for(p = &tcp_port_hash[TCP_PORT_HASH(conn->lport)]; *p != NULL;
+      p = &(*p)->pnext) {
+    if(*p == conn) {
+      *p = conn->pnext;
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Find the connection that is not closed and has the given local
+   port, remote port and remote IP address. */
+static struct uip_conn *
+tcp_lookup(u16_t lport, u16_t rport, u16_t *ipaddr)
+{
+  struct uip_conn *conn;
+
+  for(conn = tcp_conn_hash[tcp_conn_hashval(lport, rport, ipaddr)];
+      conn != NULL; conn = conn->hnext) {
+    if(conn->lport == lport &&
+       conn->rport == rport &&
+       uip_ipaddr_cmp(ipaddr, conn->ripaddr)) {
+      return conn;
+    }
+  }
+  return NULL;
+}
+#endif /* UIP_CONN_POOL */
+/*---------------------------------------------------------------------------*/
+/* Find an unused connection for a new connection. Closed connections
+   are used first. If all connections are in use, the oldest
+   connection in TIME_WAIT is reused instead. Thanks to Eddie C. Dost
+   for a very nice algorithm for the TIME_WAIT search. */
+static struct uip_conn *
+conn_alloc(void)
+{
+  register struct uip_conn *conn, *cconn;
+
+#if UIP_CONN_POOL
+  unsigned int n;
+
+  if(freeconns == NULL && uip_conns_num < conns_limit) {
+    /* The free list is empty, so we take another slab of the pool
+       into use. The connections are pushed in reverse order so that
+       the lowest one is handed out first. */
+    n = conns_limit - uip_conns_num;
+    if(n > UIP_CONN_POOL_SLAB) {
+      n = UIP_CONN_POOL_SLAB;
+    }
+    for(conn = &uip_conns[uip_conns_num + n];
+	conn > &uip_conns[uip_conns_num];) {
+      --conn;
+      conn->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_TIMER_WHEEL
+      conn->twpprev = NULL;
+#endif /* UIP_TCP_TIMER_WHEEL */
+#if UIP_READY_LIST
+      conn->rdpprev = NULL;
+#endif /* UIP_READY_LIST */
+      conn->nextfree = freeconns;
+      freeconns = conn;
+    }
+    uip_conns_num += n;
+  }
+
+  if(freeconns != NULL) {
+    conn = freeconns;
+    freeconns = conn->nextfree;
+    return conn;
+  }
+  /* All closed connections are on the free list, so only connections
+     in TIME_WAIT are left to look at. */
+#endif /* UIP_CONN_POOL */
+
+  conn = 0;
+  for(cconn = &uip_conns[0]; cconn < &uip_conns[UIP_CONNS]; ++cconn) {
+    if(cconn->tcpstateflags == UIP_CLOSED) {
+      return cconn;
+    }
+    if(cconn->tcpstateflags == UIP_TIME_WAIT) {
+#if UIP_TCP_TIMER_WHEEL
+      /* The timers are not updated on every tick, but the connection
+	 that expires first is the oldest one. */
+      if(conn == 0 ||
+	 (int)(cconn->twexpire - conn->twexpire) < 0) {
+#else /* UIP_TCP_TIMER_WHEEL */
+      if(conn == 0 ||
+	 cconn->timer > conn->timer) {
+#endif /* UIP_TCP_TIMER_WHEEL */
+	conn = cconn;
+      }
+    }
+  }
+#if UIP_CONN_POOL
+  if(conn != 0) {
+    /* The connection is taken over from TIME_WAIT, and may get
+       other ports and another remote address. */
+    tcp_unhash(conn);
+  }
+#endif /* UIP_CONN_POOL */
+  return conn;
+}
+/*---------------------------------------------------------------------------*/
+/* Move a connection to the CLOSED state and make it available for
+   new connections. */
+static void
+conn_free(register struct uip_conn *conn)
+{
+#if UIP_CONN_POOL
+  if(conn->tcpstateflags != UIP_CLOSED) {
+    tcp_unhash(conn);
+    conn->nextfree = freeconns;
+    freeconns = conn;
+  }
+#endif /* UIP_CONN_POOL */
+#if UIP_TCP_TIMER_WHEEL
+  wheel_unlink(conn);
+  conn->twkind = TW_NONE;
+#endif /* UIP_TCP_TIMER_WHEEL */
+#if UIP_READY_LIST
+  ready_unlink(conn);
+#endif /* UIP_READY_LIST */
+#if UIP_TCP_FASTOPEN
+  if(conn->tcpstateflags != UIP_CLOSED) {
+    tfo_clear(conn);
+  }
+#endif /* UIP_TCP_FASTOPEN */
+  conn->tcpstateflags = UIP_CLOSED;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_ACTIVE_OPEN
+struct uip_conn *
+uip_connect(uip_ipaddr_t *ripaddr, u16_t rport)
+{
+  register struct uip_conn *conn;
+  u16_t tries;
+  
+  /* Find an unused local port. һõıض˿ں*/
+  tries = 0;
+ again:
+  ++lastport;
+
+  if(lastport >= 32000) {
+    lastport = 4096;
+  }
+  /* Give up when every port in the range has been tried. */
+  if(++tries > 32000 - 4096) {
+    return 0;
+  }
+
+  /* Check if this port is already in use, and if so try to find
+     another one. ˿ںǷǱʹãʹҪһ*/
+#if UIP_CONN_POOL
+  /* Connections that were accepted on a listening port are not in the
+     port hash table, so the listening ports are checked as well, and
+     a connection that took the port over from a listener that has
+     since been closed is found by its remote end. */
+  for(conn = tcp_port_hash[TCP_PORT_HASH(htons(lastport))];
+      conn != NULL; conn = conn->pnext) {
+    if(conn->lport == htons(lastport)) {
+      goto again;
+    }
+  }
+  for(c = 0; c < UIP_LISTENPORTS; ++c) {
+    if(uip_listenports[c] == htons(lastport)) {
+      goto again;
+    }
+  }
+  if(tcp_lookup(htons(lastport), rport, (u16_t *)ripaddr) != NULL) {
+    goto again;
+  }
+#else /* UIP_CONN_POOL */
+  for(conn = &uip_conns[0]; conn < &uip_conns[UIP_CONNS]; ++conn) {
+    if(conn->tcpstateflags != UIP_CLOSED &&
+       conn->lport == htons(lastport)) {
+      goto again;
+    }
+  }
+#endif /* UIP_CONN_POOL */
+
+  conn = conn_alloc();
+  if(conn == 0) {
+    return 0;
+  }
+  
+  conn->tcpstateflags = UIP_SYN_SENT;
+
+  conn->snd_nxt[0] = iss[0];
+  conn->snd_nxt[1] = iss[1];
+  conn->snd_nxt[2] = iss[2];
+  conn->snd_nxt[3] = iss[3];
+
+  conn->initialmss = conn->mss = UIP_TCP_MSS;
+  
+  conn->len = 1;   /* TCP length of the SYN is one. */
+  conn->nrtx = 0;
+  conn->timer = 1; /* Send the SYN next time around. */
+  conn->rto = UIP_RTO;
+  conn->sa = 0;
+  conn->sv = 16;   /* Initial value of the RTT variance. */
+  conn->lport = htons(lastport);
+  conn->rport = rport;
+  uip_ipaddr_copy(&conn->ripaddr, ripaddr);
+#if UIP_CONN_POOL
+  tcp_hash(conn, 1);
+#endif /* UIP_CONN_POOL */
+#if UIP_PMTUD
+  conn->initialmss = conn->mss = pmtu_mss(ripaddr);
+#endif /* UIP_PMTUD */
+#if UIP_TCP_KEEPALIVE
+  conn->kaidle = conn->katimer = UIP_TCP_KEEPALIVE_IDLE;
+  conn->kaintvl = UIP_TCP_KEEPALIVE_INTVL;
+  conn->kacnt = UIP_TCP_KEEPALIVE_CNT;
+  conn->kaprobes = 0;
+#endif /* UIP_TCP_KEEPALIVE */
+#if UIP_TCP_FASTOPEN
+  conn->fastopen = TFO_COOKIE;
+#endif /* UIP_TCP_FASTOPEN */
+#if UIP_LSO
+  conn->wnd = 0;
+#endif /* UIP_LSO */
+#if UIP_TCP_PERSIST
+  conn->persist = 0;
+#endif /* UIP_TCP_PERSIST */
+#if UIP_TCP_RXBUF
+  conn->rxbuf = NULL;
+#endif /* UIP_TCP_RXBUF */
+#if UIP_TCP_TXBUF
+  conn->txbuf = NULL;
+  conn->txclose = 0;
+#endif /* UIP_TCP_TXBUF */
+#if UIP_PACING
+  conn->pacer.rate = 0;
+  conn->pacer.held = 0;
+#endif /* UIP_PACING */
+#if UIP_TCP_TLP
+  conn->probed = 0;
+#endif /* UIP_TCP_TLP */
+#if UIP_TCP_ECN
+  conn->ecn = 0;
+  conn->cwnd = 0xffff;
+#if UIP_TCP_ECN_DCTCP
+  conn->alpha = 1024;
+#endif /* UIP_TCP_ECN_DCTCP */
+#endif /* UIP_TCP_ECN */
+
+#if UIP_TCP_TIMER_WHEEL
+  wheel_update(conn);
+#endif /* UIP_TCP_TIMER_WHEEL */
+  
+  return conn;
+}
+#endif /* UIP_ACTIVE_OPEN */
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP
+#if UIP_UDP_HASH
+#define UDP_PORT_HASH(lport) \
+  (((lport) ^ ((lport) >> 8)) & (UIP_UDP_HASH_SIZE - 1))
+
+static u16_t
+udp_conn_hashval(u16_t lport, u16_t rport, u16_t *ipaddr)
+{
+  u16_t h;
+  u8_t i;
+
+  h = lport ^ rport;
+  for(i = 0; i < sizeof(uip_ipaddr_t) / 2; ++i) {
+    h ^= ipaddr[i];
+  }
+  return (h ^ (h >> 8)) & (UIP_UDP_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Check if a UDP connection only accepts datagrams from one remote
+   port on one remote host. */
+static u8_t
+udp_connected(struct uip_udp_conn *conn)
+{
+  return conn->rport != 0 &&
+    !uip_ipaddr_cmp(conn->ripaddr, all_zeroes_addr) &&
+    !uip_ipaddr_cmp(conn->ripaddr, all_ones_addr);
+}
+/*---------------------------------------------------------------------------*/
+/* Put a connection into the hash tables. Connections that share a
+   local port are kept in the order they were bound, so that the
+   first one matches first as before. */
+static void
+udp_hash(struct uip_udp_conn *conn)
+{
+  struct uip_udp_conn **p;
+
+  for(p = &udp_port_hash[UDP_PORT_HASH(conn->lport)]; *p != NULL;
+      p = &(*p)->pnext);
+  conn->pnext = NULL;
+  *p = conn;
+  if(udp_connected(conn)) {
+    for(p = &udp_conn_hash[udp_conn_hashval(conn->lport, conn->rport,
+					    conn->ripaddr)];
+	*p != NULL; p = &(*p)->cnext);
+    conn->cnext = NULL;
+    *p = conn;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+udp_unhash(struct uip_udp_conn *conn)
+{
+  struct uip_udp_conn **p;
+
+  for(p = &udp_port_hash[UDP_PORT_HASH(conn->lport)]; *p != NULL;
+      p = &(*p)->pnext) {
+    if(*p == conn) {
+      *p = conn->pnext;
+      break;
+    }
+  }
+  if(udp_connected(conn)) {
+    for(p = &udp_conn_hash[udp_conn_hashval(conn->lport, conn->rport,
+					    conn->ripaddr)];
+	*p != NULL; p = &(*p)->cnext) {
+      if(*p == conn) {
+	*p = conn->cnext;
+	break;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Find the connection for the UDP datagram in uip_buf. A connection
+   that is bound to the remote host that sent the datagram is
+   preferred, then one that matches on the local port like the
+   original linear search. */
+static struct uip_udp_conn *
+udp_lookup(void)
+{
+  struct uip_udp_conn *conn;
+
+  for(conn = udp_conn_hash[udp_conn_hashval(UDPBUF->destport,
+					    UDPBUF->srcport,
+					    BUF->srcipaddr)];
+      conn != NULL; conn = conn->cnext) {
+    if(conn->lport == UDPBUF->destport &&
+       conn->rport == UDPBUF->srcport &&
+       uip_ipaddr_cmp(BUF->srcipaddr, conn->ripaddr) &&
+       UDP_GROUP_OK(conn)) {
+      return conn;
+    }
+  }
+  for(conn = udp_port_hash[UDP_PORT_HASH(UDPBUF->destport)];
+      conn != NULL; conn = conn->pnext) {
+    if(conn->lport == UDPBUF->destport &&
+       (conn->rport == 0 ||
+        UDPBUF->srcport == conn->rport) &&
+       (uip_ipaddr_cmp(conn->ripaddr, all_zeroes_addr) ||
+	uip_ipaddr_cmp(conn->ripaddr, all_ones_addr) ||
+	uip_ipaddr_cmp(BUF->srcipaddr, conn->ripaddr)) &&
+       UDP_GROUP_OK(conn)) {
+      return conn;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_UDP_HASH */
+#if UIP_UDP_RXQ
+/* The sender of a datagram in a UDP receive queue. The data of the
+   datagram follows. */
+struct udpq_hdr {
+  u16_t len;
+  u16_t rport;
+  uip_ipaddr_t ripaddr;
+};
+
+/* Copy data into the receive queue, pos bytes after the oldest
+   datagram. */
+static void
+udpq_write(struct uip_udp_conn *conn, u16_t pos, const void *data, u16_t len)
+{
+  u16_t n;
+
+  pos += conn->rxstart;
+  if(pos >= conn->rxsize) {
+    pos -= conn->rxsize;
+  }
+  n = conn->rxsize - pos;
+  if(n > len) {
+    n = len;
+  }
+  memcpy(&conn->rxbuf[pos], data, n);
+  memcpy(conn->rxbuf, (const u8_t *)data + n, len - n);
+}
+/*---------------------------------------------------------------------------*/
+/* Copy data out of the receive queue, pos bytes after the oldest
+   datagram. */
+static void
+udpq_read(struct uip_udp_conn *conn, u16_t pos, void *data, u16_t len)
+{
+  u16_t n;
+
+  pos += conn->rxstart;
+  if(pos >= conn->rxsize) {
+    pos -= conn->rxsize;
+  }
+  n = conn->rxsize - pos;
+  if(n > len) {
+    n = len;
+  }
+  memcpy(data, &conn->rxbuf[pos], n);
+  memcpy((u8_t *)data + n, conn->rxbuf, len - n);
+}
+/*---------------------------------------------------------------------------*/
+/* Put the datagram in uip_appdata, with length uip_len, in the
+   receive queue of a connection. Returns zero if it does not fit. */
+static u8_t
+udpq_put(struct uip_udp_conn *conn)
+{
+  struct udpq_hdr h;
+
+  if(uip_len > conn->rxsize - conn->rxlen ||
+     sizeof(h) > conn->rxsize - conn->rxlen - uip_len) {
+    return 0;
+  }
+  h.len = uip_len;
+  h.rport = UDPBUF->srcport;
+  uip_ipaddr_copy(h.ripaddr, BUF->srcipaddr);
+  udpq_write(conn, conn->rxlen, &h, sizeof(h));
+  udpq_write(conn, conn->rxlen + sizeof(h), uip_appdata, uip_len);
+  conn->rxlen += sizeof(h) + uip_len;
+  ++conn->rxcount;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_UDP_RXQ */
+struct uip_udp_conn *
+uip_udp_new(uip_ipaddr_t *ripaddr, u16_t rport)
+{
+  register struct uip_udp_conn *conn;
+#if UIP_CONN_POOL
+  unsigned int n;
+#endif /* UIP_CONN_POOL */
+  u16_t tries;
+  
+  /* Find an unused local port. */
+  tries = 0;
+ again:
+  ++lastport;
+
+  if(lastport >= 32000) {
+    lastport = 4096;
+  }
+  /* Give up when every port in the range has been tried. */
+  if(++tries > 32000 - 4096) {
+    return 0;
+  }
+  
+#if UIP_UDP_HASH
+  for(conn = udp_port_hash[UDP_PORT_HASH(htons(lastport))];
+      conn != NULL; conn = conn->pnext) {
+#else /* UIP_UDP_HASH */
+  for(conn = &uip_udp_conns[0];
+      conn < &uip_udp_conns[UIP_UDP_CONNS]; ++conn) {
+#endif /* UIP_UDP_HASH */
+    if(conn->lport == htons(lastport)) {
+      goto again;
+    }
+  }
+
+
+#if UIP_CONN_POOL
+  if(freeudpconns == NULL && uip_udp_conns_num < udp_conns_limit) {
+    /* Take another slab of the pool into use. */
+    n = udp_conns_limit - uip_udp_conns_num;
+    if(n > UIP_CONN_POOL_SLAB) {
+      n = UIP_CONN_POOL_SLAB;
+    }
+    for(conn = &uip_udp_conns[uip_udp_conns_num + n];
+	conn > &uip_udp_conns[uip_udp_conns_num];) {
+      --conn;
+      conn->lport = 0;
+      conn->nextfree = freeudpconns;
+      freeudpconns = conn;
+    }
+    uip_udp_conns_num += n;
+  }
+  conn = freeudpconns;
+  if(conn == 0) {
+    return 0;
+  }
+  freeudpconns = conn->nextfree;
+#else /* UIP_CONN_POOL */
+  conn = 0;
+  for(c = 0; c < UIP_UDP_CONNS; ++c) {
+    if(uip_udp_conns[c].lport == 0) {
+      conn = &uip_udp_conns[c];
+      break;
+    }
+  }
+
+  if(conn == 0) {
+    return 0;
+  }
+#endif /* UIP_CONN_POOL */
+  
+  conn->lport = HTONS(lastport);
+  conn->rport = rport;
+  if(ripaddr == NULL) {
+    memset(conn->ripaddr, 0, sizeof(uip_ipaddr_t));
+  } else {
+    uip_ipaddr_copy(&conn->ripaddr, ripaddr);
+  }
+  conn->ttl = UIP_TTL;
+#if UIP_PACING
+  conn->pacer.rate = 0;
+#endif /* UIP_PACING */
+#if UIP_UDP_RXQ
+  conn->rxbuf = NULL;
+  conn->rxcount = 0;
+#endif /* UIP_UDP_RXQ */
+#if UIP_IGMP
+  conn->group[0] = conn->group[1] = 0;
+#endif /* UIP_IGMP */
+#if UIP_UDP_SENDMSG
+  /* Make sure that the header template is built on the first send. */
+  ((struct uip_udpip_hdr *)conn->hdr)->ttl = 0;
+#endif /* UIP_UDP_SENDMSG */
+#if UIP_UDP_HASH
+  udp_hash(conn);
+#endif /* UIP_UDP_HASH */
+  
+  return conn;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_CONN_POOL || UIP_UDP_HASH || UIP_IGMP
+void
+uip_udp_remove(struct uip_udp_conn *conn)
+{
+  if(conn->lport != 0) {
+#if UIP_UDP_HASH
+    udp_unhash(conn);
+#endif /* UIP_UDP_HASH */
+#if UIP_IGMP
+    uip_udp_leave(conn);
+#endif /* UIP_IGMP */
+    conn->lport = 0;
+#if UIP_CONN_POOL
+    conn->nextfree = freeudpconns;
+    freeudpconns = conn;
+#endif /* UIP_CONN_POOL */
+  }
+}
+#endif /* UIP_CONN_POOL || UIP_UDP_HASH || UIP_IGMP */
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP_HASH
+void
+uip_udp_bind(struct uip_udp_conn *conn, u16_t port)
+{
+  if(conn->lport != 0) {
+    udp_unhash(conn);
+  }
+  conn->lport = port;
+  if(port != 0) {
+    udp_hash(conn);
+  }
+}
+#endif /* UIP_UDP_HASH */
+#if UIP_UDP_RXQ
+/*---------------------------------------------------------------------------*/
+void
+uip_udp_rxq(struct uip_udp_conn *conn, u8_t *buf, u16_t size)
+{
+  conn->rxbuf = buf;
+  conn->rxsize = size;
+  conn->rxstart = conn->rxlen = conn->rxcount = 0;
+}
+/*---------------------------------------------------------------------------*/
+u16_t
+uip_udp_recv(struct uip_udp_conn *conn, struct uip_udp_msg *msgs, u16_t n)
+{
+  struct udpq_hdr h;
+  u16_t i;
+
+  for(i = 0; i < n && conn->rxcount > 0; ++i) {
+    udpq_read(conn, 0, &h, sizeof(h));
+    msgs[i].len = h.len;
+    msgs[i].rport = h.rport;
+    uip_ipaddr_copy(msgs[i].ripaddr, h.ripaddr);
+    udpq_read(conn, sizeof(h), msgs[i].buf,
+	      h.len < msgs[i].size? h.len: msgs[i].size);
+
+    conn->rxstart += sizeof(h) + h.len;
+    if(conn->rxstart >= conn->rxsize) {
+      conn->rxstart -= conn->rxsize;
+    }
+    conn->rxlen -= sizeof(h) + h.len;
+    --conn->rxcount;
+  }
+  return i;
+}
+#endif /* UIP_UDP_RXQ */
+#if UIP_UDP_SENDMSG
+/*---------------------------------------------------------------------------*/
+/* One's complement addition of two checksums. */
+static u16_t
+sum_add(u16_t a, u16_t b)
+{
+  a += b;
+  return a < b? a + 1: a;
+}
+/*---------------------------------------------------------------------------*/
+/* Return the header template of a UDP connection, after building it
+   again if the addresses, ports or TTL of the connection have changed
+   since it was built. The lengths, IP identification and checksums
+   of the template are zero, and the checksums of the rest of it are
+   kept in the connection. */
+static struct uip_udpip_hdr *
+udp_template(struct uip_udp_conn *conn)
+{
+  struct uip_udpip_hdr *t;
+
+  t = (struct uip_udpip_hdr *)conn->hdr;
+  if(t->ttl == conn->ttl &&
+     t->srcport == conn->lport && t->destport == conn->rport &&
+     uip_ipaddr_cmp(t->srcipaddr, UIP_SRCADDR(conn->ripaddr)) &&
+     uip_ipaddr_cmp(t->destipaddr, conn->ripaddr)) {
+    return t;
+  }
+
+  memset(t, 0, UIP_IPUDPH_LEN);
+#if UIP_CONF_IPV6
+  t->vtc = 0x60;
+#else /* UIP_CONF_IPV6 */
+  t->vhl = 0x45;
+#endif /* UIP_CONF_IPV6 */
+  t->ttl = conn->ttl;
+  t->proto = UIP_PROTO_UDP;
+  uip_ipaddr_copy(t->srcipaddr, UIP_SRCADDR(conn->ripaddr));
+  uip_ipaddr_copy(t->destipaddr, conn->ripaddr);
+  t->srcport = conn->lport;
+  t->destport = conn->rport;
+
+#if !UIP_CONF_IPV6
+  conn->ipsum = uip_chksum(conn->hdr, UIP_IPH_LEN);
+#endif /* !UIP_CONF_IPV6 */
+  conn->udpsum = sum_add(HTONS(UIP_PROTO_UDP),
+			 uip_chksum((u16_t *)t->srcipaddr,
+				    2 * sizeof(uip_ipaddr_t) + 4));
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_IP_FRAG
+/* Send a datagram that is too large for uip_buf in IP fragments. The
+   UDP checksum is computed over the data where the application keeps
+   it, and each fragment is built by copying its part of the data
+   into uip_buf, so the data is copied only once. */
+static void
+udp_send_frags(struct uip_udp_conn *conn, const u8_t *data, u16_t len)
+{
+  struct uip_udpip_hdr *t;
+  u16_t off, n, total;
+#if UIP_UDP_CHECKSUMS
+  u16_t sum;
+#endif /* UIP_UDP_CHECKSUMS */
+
+  t = udp_template(conn);
+  ++ipid;
+  total = len + UIP_UDPH_LEN;
+  for(off = 0; off < total; off += n) {
+    n = total - off;
+    if(n > ((UIP_MTU - UIP_IPH_LEN) & ~7)) {
+      n = (UIP_MTU - UIP_IPH_LEN) & ~7;
+    }
+    memcpy(BUF, t, UIP_IPH_LEN);
+    if(off == 0) {
+      /* The first fragment carries the UDP header. */
+      UDPBUF->srcport = t->srcport;
+      UDPBUF->destport = t->destport;
+      UDPBUF->udplen = htons(total);
+      UDPBUF->udpchksum = 0;
+#if UIP_UDP_CHECKSUMS
+      sum = sum_add(conn->udpsum, UDPBUF->udplen);
+      sum = sum_add(sum, UDPBUF->udplen);
+      sum = sum_add(sum, uip_chksum((u16_t *)data, len));
+      UDPBUF->udpchksum = ~sum;
+      if(UDPBUF->udpchksum == 0) {
+	UDPBUF->udpchksum = 0xffff;
+      }
+#endif /* UIP_UDP_CHECKSUMS */
+      memcpy(&uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN], data,
+	     n - UIP_UDPH_LEN);
+    } else {
+      memcpy(&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN],
+	     &data[off - UIP_UDPH_LEN], n);
+    }
+
+    uip_len = UIP_IPH_LEN + n;
+    BUF->len[0] = (uip_len >> 8);
+    BUF->len[1] = (uip_len & 0xff);
+    BUF->ipid[0] = ipid >> 8;
+    BUF->ipid[1] = ipid & 0xff;
+    BUF->ipoffset[0] = ((off / 8) >> 8) | (off + n < total? IP_MF: 0);
+    BUF->ipoffset[1] = (off / 8) & 0xff;
+    BUF->ipchksum = 0;
+    BUF->ipchksum = ~(uip_ipchksum());
+
+    UIP_STAT(++uip_stat.ip.sent);
+    UIP_UDP_SENDMSG_OUTPUT();
+  }
+  UIP_STAT(++uip_stat.udp.sent);
+  uip_len = 0;
+}
+#endif /* UIP_IP_FRAG */
+/*---------------------------------------------------------------------------*/
+u8_t
+uip_udp_sendmsg(struct uip_udp_conn *conn, const void *data, u16_t len)
+{
+#if UIP_UDP_CHECKSUMS
+  u16_t sum;
+#endif /* UIP_UDP_CHECKSUMS */
+
+#if UIP_IP_FRAG
+  if(len > 0xffff - UIP_IPUDPH_LEN) {
+    return 0;
+  }
+#else /* UIP_IP_FRAG */
+  if(len > UIP_MTU - UIP_IPUDPH_LEN) {
+    return 0;
+  }
+#endif /* UIP_IP_FRAG */
+#if UIP_PACING
+  if(conn->pacer.rate != 0) {
+    if(!pace_refill(&conn->pacer)) {
+      return 0;
+    }
+    pace_take(&conn->pacer, len);
+  }
+#endif /* UIP_PACING */
+
+#if UIP_IP_FRAG
+  if(len > UIP_MTU - UIP_IPUDPH_LEN) {
+    udp_send_frags(conn, data, len);
+    return 1;
+  }
+#endif /* UIP_IP_FRAG */
+  if(data != &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN]) {
+    memmove(&uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN], data, len);
+  }
+  memcpy(BUF, udp_template(conn), UIP_IPUDPH_LEN);
+  uip_len = len + UIP_IPUDPH_LEN;
+
+#if UIP_CONF_IPV6
+  BUF->len[0] = ((uip_len - UIP_IPH_LEN) >> 8);
+  BUF->len[1] = ((uip_len - UIP_IPH_LEN) & 0xff);
+#else /* UIP_CONF_IPV6 */
+  BUF->len[0] = (uip_len >> 8);
+  BUF->len[1] = (uip_len & 0xff);
+  ++ipid;
+  BUF->ipid[0] = ipid >> 8;
+  BUF->ipid[1] = ipid & 0xff;
+  /* The length and identification fields are next to each other. */
+  BUF->ipchksum = ~sum_add(conn->ipsum, uip_chksum((u16_t *)BUF->len, 4));
+#endif /* UIP_CONF_IPV6 */
+  UDPBUF->udplen = HTONS(len + UIP_UDPH_LEN);
+
+#if UIP_UDP_CHECKSUMS
+  /* The UDP length is counted both in the pseudo header and in the
+     UDP header. */
+  sum = sum_add(conn->udpsum, UDPBUF->udplen);
+  sum = sum_add(sum, UDPBUF->udplen);
+  sum = sum_add(sum, uip_chksum((u16_t *)&uip_buf[UIP_LLH_LEN +
+						   UIP_IPUDPH_LEN], len));
+  UDPBUF->udpchksum = ~sum;
+  if(UDPBUF->udpchksum == 0) {
+    UDPBUF->udpchksum = 0xffff;
+  }
+#endif /* UIP_UDP_CHECKSUMS */
+
+  UIP_STAT(++uip_stat.udp.sent);
+  UIP_STAT(++uip_stat.ip.sent);
+#if UIP_DUAL_STACK
+  ip4_output();
+#endif /* UIP_DUAL_STACK */
+  UIP_UDP_SENDMSG_OUTPUT();
+  uip_len = 0;
+  return 1;
+}
+#endif /* UIP_UDP_SENDMSG */
+/*---------------------------------------------------------------------------*/
+#if UIP_CONN_POOL
+void
+uip_udp_conn_pool_init(struct uip_udp_conn *mem, unsigned int limit)
+{
+  uip_udp_conns = mem;
+  uip_udp_conns_num = 0;
+  udp_conns_limit = limit;
+  freeudpconns = NULL;
+}
+#endif /* UIP_CONN_POOL */
+#endif /* UIP_UDP */
+/*---------------------------------------------------------------------------*/
+void
+uip_unlisten(u16_t port)
+{
+  for(c = 0; c < UIP_LISTENPORTS; ++c) {
+    if(uip_listenports[c] == port) {
+      uip_listenports[c] = 0;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_listen(u16_t port)
+{
+  for(c = 0; c < UIP_LISTENPORTS; ++c) {
+    if(uip_listenports[c] == 0) {
+      uip_listenports[c] = port;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_IGMP
+/* A pseudo-random number from 1 to n, for spreading out reports. */
+static u16_t
+igmp_rand(u16_t n)
+{
+  igmp_seed = igmp_seed * 25173 + 13849 + uip_hostaddr[1];
+  return (igmp_seed >> 4) % n + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Find a group that is joined or being left. */
+static struct igmp_group *
+igmp_find(const uip_ipaddr_t *addr)
+{
+  struct igmp_group *g;
+
+  for(g = igmp_groups; g < &igmp_groups[UIP_IGMP_GROUPS]; ++g) {
+    if((g->refs > 0 || g->count > 0) && uip_ipaddr_cmp(g->addr, addr)) {
+      return g;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Build the destination filter from the joined groups. */
+static void
+igmp_refilter(void)
+{
+  struct igmp_group *g;
+  u8_t h;
+
+  memset(igmp_filter, 0, sizeof(igmp_filter));
+  for(g = igmp_groups; g < &igmp_groups[UIP_IGMP_GROUPS]; ++g) {
+    if(g->refs > 0) {
+      h = IGMP_HASH(g->addr);
+      igmp_filter[h >> 3] |= 1 << (h & 7);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Non-zero if packets sent to the multicast address are for us. The
+   filter turns most other groups away without a search. */
+static u8_t
+igmp_member(const uip_ipaddr_t *addr)
+{
+  struct igmp_group *g;
+  u8_t h;
+
+  if(uip_ipaddr_cmp(addr, igmp_all_hosts)) {
+    return 1;
+  }
+  h = IGMP_HASH(addr);
+  if((igmp_filter[h >> 3] & (1 << (h & 7))) == 0) {
+    return 0;
+  }
+  g = igmp_find(addr);
+  return g != NULL && g->refs > 0;
+}
+/*---------------------------------------------------------------------------*/
+u8_t
+uip_igmp_join(uip_ipaddr_t *group)
+{
+  struct igmp_group *g;
+
+  if(uip_ipaddr_cmp(group, igmp_all_hosts)) {
+    /* All hosts are always members, and never report it. */
+    return 1;
+  }
+  g = igmp_find(group);
+  if(g == NULL) {
+    for(g = igmp_groups; g < &igmp_groups[UIP_IGMP_GROUPS]; ++g) {
+      if(g->refs == 0 && g->count == 0) {
+	break;
+      }
+    }
+    if(g == &igmp_groups[UIP_IGMP_GROUPS]) {
+      return 0;
+    }
+    uip_ipaddr_copy(g->addr, group);
+  }
+  if(g->refs++ == 0) {
+    /* The new membership is reported at the next tick, and repeated
+       in case the report is lost. */
+    g->count = IGMP_ROBUSTNESS;
+    g->timer = 1;
+    igmp_refilter();
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_igmp_leave(uip_ipaddr_t *group)
+{
+  struct igmp_group *g;
+
+  g = igmp_find(group);
+  if(g != NULL && g->refs > 0 && --g->refs == 0) {
+    /* An IGMPv2 leave is sent once, an IGMPv3 change as many times as
+       a join. The group stays in the table until then. */
+    g->count = igmp_v2 > 0? 1: IGMP_ROBUSTNESS;
+    g->timer = 1;
+    igmp_refilter();
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP
+u8_t
+uip_udp_join(struct uip_udp_conn *conn, uip_ipaddr_t *group)
+{
+  uip_udp_leave(conn);
+  if(!uip_igmp_join(group)) {
+    return 0;
+  }
+  uip_ipaddr_copy(conn->group, group);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_udp_leave(struct uip_udp_conn *conn)
+{
+  if((conn->group[0] | conn->group[1]) != 0) {
+    uip_igmp_leave(&conn->group);
+    conn->group[0] = conn->group[1] = 0;
+  }
+}
+#endif /* UIP_UDP */
+/*---------------------------------------------------------------------------*/
+/* Process the IGMP message in uip_buf, which follows an IP header of
+   hlen bytes. Reports are not sent right away, but at a random time
+   before the deadline of the query, by igmp_periodic(). */
+static void
+igmp_input(u8_t hlen)
+{
+  struct igmp_hdr *m;
+  struct igmp_group *g;
+  u16_t max;
+
+  m = (struct igmp_hdr *)&uip_buf[UIP_LLH_LEN + hlen];
+  if(uip_len < hlen + 8 ||
+     (hlen != UIP_IPH_LEN && uip_chksum((u16_t *)BUF, hlen) != 0xffff) ||
+     uip_chksum((u16_t *)m, uip_len - hlen) != 0xffff) {
+    UIP_LOG("igmp: bad checksum.");
+    return;
+  }
+
+  switch(m->type) {
+  case IGMP_QUERY:
+    if(uip_len - hlen == 8) {
+      /* An IGMPv1 or IGMPv2 query. The querier does not understand
+	 IGMPv3 reports. */
+      igmp_v2 = IGMP_V2_TIMEOUT;
+      max = m->maxresp == 0? 100: m->maxresp;
+    } else if(uip_len - hlen >= 12) {
+      max = m->maxresp < 128? m->maxresp:
+	((m->maxresp & 0x0f) | 0x10) << (((m->maxresp >> 4) & 7) + 3);
+    } else {
+      return;
+    }
+    max /= UIP_IGMP_TICK;
+    if(max == 0) {
+      max = 1;
+    }
+    for(g = igmp_groups; g < &igmp_groups[UIP_IGMP_GROUPS]; ++g) {
+      if(g->refs > 0 &&
+	 ((m->group[0] | m->group[1]) == 0 ||
+	  uip_ipaddr_cmp(m->group, g->addr)) &&
+	 (g->timer == 0 || g->timer > max)) {
+	g->timer = igmp_rand(max);
+      }
+    }
+    break;
+  case IGMP_V1_REPORT:
+  case IGMP_V2_REPORT:
+    /* Another member has answered the query for the group, so we need
+       not. */
+    if(igmp_v2 > 0) {
+      g = igmp_find(&m->group);
+      if(g != NULL && g->refs > 0 && g->count == 0) {
+	g->timer = 0;
+      }
+    }
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Count down the report timers, and build the IGMP message for the
+   groups that are due in uip_buf. An IGMPv3 report holds a record for
+   each group, as many as fit in the MTU; an IGMPv2 message is about
+   one group. The groups that are left have to wait for the next
+   tick. */
+static void
+igmp_periodic(void)
+{
+  struct igmp_group *g, *due;
+  struct igmp_hdr *m;
+  u8_t *rec;
+  u16_t n;
+
+  uip_len = 0;
+  if(igmp_v2 > 0) {
+    --igmp_v2;
+  }
+
+  m = (struct igmp_hdr *)&uip_buf[UIP_LLH_LEN + IGMP_IPH_LEN];
+  rec = (u8_t *)m + 8;
+  due = NULL;
+  n = 0;
+  for(g = igmp_groups; g < &igmp_groups[UIP_IGMP_GROUPS]; ++g) {
+    if(g->timer == 0 || --g->timer > 0) {
+      continue;
+    }
+    if((igmp_v2 > 0 && due != NULL) ||
+       (igmp_v2 == 0 && n == IGMP_V3_RECORDS)) {
+      g->timer = 1;
+      continue;
+    }
+    due = g;
+    if(igmp_v2 == 0) {
+      rec[0] = g->refs == 0? IGMP_TO_INCLUDE:
+	g->count > 0? IGMP_TO_EXCLUDE: IGMP_IS_EXCLUDE;
+      rec[1] = rec[2] = rec[3] = 0;
+      memcpy(&rec[4], g->addr, 4);
+      rec += 8;
+      ++n;
+    }
+    if(g->count > 0 && --g->count > 0) {
+      g->timer = igmp_rand(IGMP_UNSOLICITED);
+    }
+  }
+  if(due == NULL) {
+    return;
+  }
+
+  if(igmp_v2 > 0) {
+    m->maxresp = 0;
+    uip_ipaddr_copy(m->group, due->addr);
+    if(due->refs == 0) {
+      m->type = IGMP_V2_LEAVE;
+      uip_ipaddr_copy(BUF->destipaddr, igmp_all_routers);
+    } else {
+      m->type = IGMP_V2_REPORT;
+      uip_ipaddr_copy(BUF->destipaddr, due->addr);
+    }
+    n = 8;
+  } else {
+    m->type = IGMP_V3_REPORT;
+    m->maxresp = 0;
+    m->group[0] = 0;
+    m->group[1] = htons(n);
+    uip_ipaddr_copy(BUF->destipaddr, igmp_v3_routers);
+    n = 8 + 8 * n;
+  }
+  m->chksum = 0;
+  m->chksum = ~(uip_chksum((u16_t *)m, n));
+
+  /* IGMP messages are sent with a TTL of one and a router alert
+     option. */
+  uip_len = IGMP_IPH_LEN + n;
+  BUF->vhl = 0x46;
+  BUF->tos = 0xc0;
+  BUF->len[0] = (uip_len >> 8);
+  BUF->len[1] = (uip_len & 0xff);
+  ++ipid;
+  BUF->ipid[0] = ipid >> 8;
+  BUF->ipid[1] = ipid & 0xff;
+  BUF->ipoffset[0] = BUF->ipoffset[1] = 0;
+  BUF->ttl = 1;
+  BUF->proto = UIP_PROTO_IGMP;
+  uip_ipaddr_copy(BUF->srcipaddr, uip_hostaddr);
+  uip_buf[UIP_LLH_LEN + UIP_IPH_LEN] = 0x94;
+  uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + 1] = 4;
+  uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + 2] = 0;
+  uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + 3] = 0;
+  BUF->ipchksum = 0;
+  BUF->ipchksum = ~(uip_chksum((u16_t *)BUF, IGMP_IPH_LEN));
+  UIP_STAT(++uip_stat.ip.sent);
+}
+#endif /* UIP_IGMP */
+/*---------------------------------------------------------------------------*/
+/* IP fragment reassembly. Several datagrams can be reassembled at the
+   same time, each in a context that is found through a hash of the
+   source address and IP identification. The fragments are copied into
+   blocks from a shared pool as they arrive, so a context only takes
+   as many blocks as its datagram needs, and a bitmap with a bit for
+   each eight bytes of the datagram records what has been received.
+   The same contexts serve IPv4 fragments and the fragment headers of
+   IPv6; only the identification differs. */
+
+#if UIP_REASSEMBLY
+#define UIP_REASS_BUFSIZE (UIP_BUFSIZE - UIP_LLH_LEN)
+/* The largest payload of a reassembled datagram. */
+#define REASS_MAXLEN      (UIP_REASS_BUFSIZE - UIP_IPH_LEN)
+#define REASS_BLOCKS      ((REASS_MAXLEN + UIP_REASS_BLOCK - 1) / \
+			   UIP_REASS_BLOCK)
+#define REASS_POOL_BLOCKS (UIP_REASS_POOLSIZE / UIP_REASS_BLOCK)
+#define REASS_HASH_SIZE   8
+/* The length of the identification of a datagram: the IP
+   identification and protocol for IPv4, the identification of the
+   fragment header for IPv6. */
+#define REASS_IDLEN       4
+
+#if REASS_POOL_BLOCKS > 255
+#error "UIP_REASS_POOLSIZE / UIP_REASS_BLOCK must be at most 255"
+#endif
+
+struct reass_ctx {
+  struct reass_ctx *hnext;     /* Next context in the hash bucket. */
+  u16_t hdr[UIP_IPH_LEN / 2];  /* The IP header of the first fragment
+				  that arrived. */
+  u8_t id[REASS_IDLEN];        /* The identification of the
+				  datagram. */
+  u16_t len;                   /* The length of the payload, or zero
+				  until the last fragment has
+				  arrived. */
+  u8_t timer;                  /* Ticks left, or zero if unused. */
+  u8_t block[REASS_BLOCKS];    /* One more than the pool block of
+				  each part of the payload, or zero. */
+  u8_t bitmap[(REASS_MAXLEN + 63) / 64];
+};
+
+static struct reass_ctx reass_ctxs[UIP_REASS_CONTEXTS];
+static struct reass_ctx *reass_hash[REASS_HASH_SIZE];
+static u8_t reass_pool[REASS_POOL_BLOCKS][UIP_REASS_BLOCK];
+static u8_t reass_used[(REASS_POOL_BLOCKS + 7) / 8];
+
+#define REASS_HDR(ctx) ((struct uip_tcpip_hdr *)(ctx)->hdr)
+#define REASS_HASH(id, hdr) (((id)[1] ^ (id)[3] ^ \
+			      ((u8_t *)(hdr)->srcipaddr) \
+			      [sizeof(uip_ipaddr_t) - 1]) & \
+			     (REASS_HASH_SIZE - 1))
+
+/* Give the blocks of a context back to the pool and take it out of
+   the hash table. */
+static void
+reass_free(struct reass_ctx *ctx)
+{
+  struct reass_ctx **p;
+  u8_t i, b;
+
+  for(i = 0; i < REASS_BLOCKS; ++i) {
+    if(ctx->block[i] != 0) {
+      b = ctx->block[i] - 1;
+      reass_used[b >> 3] &= ~(1 << (b & 7));
+    }
+  }
+  for(p = &reass_hash[REASS_HASH(ctx->id, REASS_HDR(ctx))]; *p != NULL;
+      p = &(*p)->hnext) {
+    if(*p == ctx) {
+      *p = ctx->hnext;
+      break;
+    }
+  }
+  ctx->timer = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Age the contexts, and drop the datagrams that have not been
+   completed in time. */
+static void
+reass_tick(void)
 {
-  register struct uip_conn *conn, *cconn;
-  
-  /* Find an unused local port. һõıض˿ں*/
- again:
-  ++lastport;
+  struct reass_ctx *ctx;
 
-  if(lastport >= 32000) {
-    lastport = 4096;
+  for(ctx = reass_ctxs; ctx < &reass_ctxs[UIP_REASS_CONTEXTS]; ++ctx) {
+    if(ctx->timer != 0 && --ctx->timer == 0) {
+      reass_free(ctx);
+      UIP_STAT(++uip_stat.ip.drop);
+      UIP_STAT(++uip_stat.ip.fragerr);
+    }
   }
-
-  /* Check if this port is already in use, and if so try to find
-     another one. ˿ںǷǱʹãʹҪһ*/
-  for(c = 0; c < UIP_CONNS; ++c) {
-    conn = &uip_conns[c];
-    if(conn->tcpstateflags != UIP_CLOSED &&
-       conn->lport == htons(lastport)) {
-      goto again;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the context of the datagram that the fragment in uip_buf
+   belongs to, or start a new one. If all contexts are in use, the
+   oldest one is dropped. */
+static struct reass_ctx *
+reass_find(const u8_t *id)
+{
+  struct reass_ctx *ctx, *oldest;
+  struct uip_tcpip_hdr *h;
+  u8_t hash;
+
+  hash = REASS_HASH(id, BUF);
+  for(ctx = reass_hash[hash]; ctx != NULL; ctx = ctx->hnext) {
+    h = REASS_HDR(ctx);
+    if(memcmp(ctx->id, id, REASS_IDLEN) == 0 &&
+       uip_ipaddr_cmp(BUF->srcipaddr, h->srcipaddr) &&
+       uip_ipaddr_cmp(BUF->destipaddr, h->destipaddr)) {
+      return ctx;
     }
   }
 
-  conn = 0;
-  for(c = 0; c < UIP_CONNS; ++c) {
-    cconn = &uip_conns[c];
-    if(cconn->tcpstateflags == UIP_CLOSED) {
-      conn = cconn;
+  oldest = reass_ctxs;
+  for(ctx = reass_ctxs; ctx < &reass_ctxs[UIP_REASS_CONTEXTS]; ++ctx) {
+    if(ctx->timer == 0) {
       break;
     }
-    if(cconn->tcpstateflags == UIP_TIME_WAIT) {
-      if(conn == 0 ||
-	 cconn->timer > conn->timer) {
-	conn = cconn;
-      }
+    if(ctx->timer < oldest->timer) {
+      oldest = ctx;
     }
   }
-
-  if(conn == 0) {
-    return 0;
+  if(ctx == &reass_ctxs[UIP_REASS_CONTEXTS]) {
+    ctx = oldest;
+    reass_free(ctx);
+    UIP_STAT(++uip_stat.ip.drop);
+    UIP_STAT(++uip_stat.ip.fragerr);
   }
-  
-  conn->tcpstateflags = UIP_SYN_SENT;
-
-  conn->snd_nxt[0] = iss[0];
-  conn->snd_nxt[1] = iss[1];
-  conn->snd_nxt[2] = iss[2];
-  conn->snd_nxt[3] = iss[3];
 
-  conn->initialmss = conn->mss = UIP_TCP_MSS;
-  
-  conn->len = 1;   /* TCP length of the SYN is one. */
-  conn->nrtx = 0;
-  conn->timer = 1; /* Send the SYN next time around. */
-  conn->rto = UIP_RTO;
-  conn->sa = 0;
-  conn->sv = 16;   /* Initial value of the RTT variance. */
-  conn->lport = htons(lastport);
-  conn->rport = rport;
-  uip_ipaddr_copy(&conn->ripaddr, ripaddr);
-  
-  return conn;
+  memcpy(ctx->hdr, BUF, UIP_IPH_LEN);
+  memcpy(ctx->id, id, REASS_IDLEN);
+  ctx->len = 0;
+  ctx->timer = UIP_REASS_MAXAGE;
+  memset(ctx->block, 0, sizeof(ctx->block));
+  memset(ctx->bitmap, 0, sizeof(ctx->bitmap));
+  ctx->hnext = reass_hash[hash];
+  reass_hash[hash] = ctx;
+  return ctx;
 }
-#endif /* UIP_ACTIVE_OPEN */
 /*---------------------------------------------------------------------------*/
-#if UIP_UDP
-struct uip_udp_conn *
-uip_udp_new(uip_ipaddr_t *ripaddr, u16_t rport)
+/* Copy part of a fragment into the blocks of a context, taking blocks
+   from the pool as they are needed. Returns zero if the pool is
+   empty. */
+static u8_t
+reass_copy(struct reass_ctx *ctx, u16_t offset, const u8_t *data, u16_t len)
 {
-  register struct uip_udp_conn *conn;
-  
-  /* Find an unused local port. */
- again:
-  ++lastport;
-
-  if(lastport >= 32000) {
-    lastport = 4096;
-  }
-  
-  for(c = 0; c < UIP_UDP_CONNS; ++c) {
-    if(uip_udp_conns[c].lport == htons(lastport)) {
-      goto again;
+  u16_t n;
+  u8_t b, i;
+
+  while(len > 0) {
+    b = offset / UIP_REASS_BLOCK;
+    if(ctx->block[b] == 0) {
+      for(i = 0; i < REASS_POOL_BLOCKS; ++i) {
+	if((reass_used[i >> 3] & (1 << (i & 7))) == 0) {
+	  break;
+	}
+      }
+      if(i == REASS_POOL_BLOCKS) {
+	return 0;
+      }
+      reass_used[i >> 3] |= 1 << (i & 7);
+      ctx->block[b] = i + 1;
     }
-  }
-
-
-  conn = 0;
-  for(c = 0; c < UIP_UDP_CONNS; ++c) {
-    if(uip_udp_conns[c].lport == 0) {
-      conn = &uip_udp_conns[c];
-      break;
+    n = UIP_REASS_BLOCK - offset % UIP_REASS_BLOCK;
+    if(n > len) {
+      n = len;
     }
+    memcpy(&reass_pool[ctx->block[b] - 1][offset % UIP_REASS_BLOCK],
+	   data, n);
+    offset += n;
+    data += n;
+    len -= n;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Set the bits of the eight-byte units from..to-1 in a bitmap. */
+static void
+reass_mark(u8_t *bitmap, u16_t from, u16_t to)
+{
+  while(from < to && (from & 7) != 0) {
+    bitmap[from >> 3] |= 1 << (from & 7);
+    ++from;
+  }
+  while(from + 8 <= to) {
+    bitmap[from >> 3] = 0xff;
+    from += 8;
   }
+  while(from < to) {
+    bitmap[from >> 3] |= 1 << (from & 7);
+    ++from;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Non-zero if all of the datagram of a context has arrived. */
+static u8_t
+reass_complete(struct reass_ctx *ctx)
+{
+  u16_t units, i;
+  u8_t mask;
 
-  if(conn == 0) {
+  if(ctx->len == 0 || ctx->len > REASS_MAXLEN) {
     return 0;
   }
-  
-  conn->lport = HTONS(lastport);
-  conn->rport = rport;
-  if(ripaddr == NULL) {
-    memset(conn->ripaddr, 0, sizeof(uip_ipaddr_t));
-  } else {
-    uip_ipaddr_copy(&conn->ripaddr, ripaddr);
+  units = (ctx->len + 7) / 8;
+  for(i = 0; i < units >> 3; ++i) {
+    if(ctx->bitmap[i] != 0xff) {
+      return 0;
+    }
   }
-  conn->ttl = UIP_TTL;
-  
-  return conn;
+  /* When the datagram fills the last byte of the bitmap, there is no
+     partly used byte after it to look at. */
+  if((units & 7) == 0) {
+    return 1;
+  }
+  mask = (1 << (units & 7)) - 1;
+  return (ctx->bitmap[units >> 3] & mask) == mask;
 }
-#endif /* UIP_UDP */
 /*---------------------------------------------------------------------------*/
-void
-uip_unlisten(u16_t port)
+/* Add a fragment, with the IP header in uip_buf, to its datagram.
+   When the whole datagram has arrived, it is put together in uip_buf
+   behind the IP header of the first fragment that arrived, and the
+   length of its payload is returned. Otherwise zero is returned. */
+static u16_t
+reass_add(const u8_t *id, u16_t offset, const u8_t *data, u16_t len,
+	  u8_t more)
 {
-  for(c = 0; c < UIP_LISTENPORTS; ++c) {
-    if(uip_listenports[c] == port) {
-      uip_listenports[c] = 0;
-      return;
-    }
+  struct reass_ctx *ctx;
+  u16_t n;
+  u8_t i;
+
+  /* A datagram that would not fit in uip_buf is not reassembled. All
+     fragments but the last carry a multiple of eight bytes. */
+  if(offset + len > REASS_MAXLEN || (more && (len & 7) != 0)) {
+    UIP_STAT(++uip_stat.ip.drop);
+    UIP_STAT(++uip_stat.ip.fragerr);
+    return 0;
+  }
+
+  ctx = reass_find(id);
+  if((ctx->len != 0 && offset + len > ctx->len) ||
+     !reass_copy(ctx, offset, data, len)) {
+    reass_free(ctx);
+    UIP_STAT(++uip_stat.ip.drop);
+    UIP_STAT(++uip_stat.ip.fragerr);
+    return 0;
+  }
+  reass_mark(ctx->bitmap, offset / 8, (offset + len + 7) / 8);
+
+  /* If this fragment is the last one, we know the size of the entire
+     packet. */
+  if(!more) {
+    ctx->len = offset + len;
+  }
+
+  if(!reass_complete(ctx)) {
+    return 0;
+  }
+
+  /* The whole datagram has arrived, so we put it together in uip_buf
+     and pretend that it was never fragmented. */
+  memcpy(BUF, ctx->hdr, UIP_IPH_LEN);
+  for(i = 0, offset = 0; offset < ctx->len; ++i, offset += n) {
+    n = ctx->len - offset > UIP_REASS_BLOCK? UIP_REASS_BLOCK:
+      ctx->len - offset;
+    memcpy(&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + offset],
+	   reass_pool[ctx->block[i] - 1], n);
   }
+  len = ctx->len;
+  reass_free(ctx);
+  return len;
 }
 /*---------------------------------------------------------------------------*/
-void
-uip_listen(u16_t port)
+#if !UIP_CONF_IPV6
+static u16_t
+uip_reass(void)
 {
-  for(c = 0; c < UIP_LISTENPORTS; ++c) {
-    if(uip_listenports[c] == 0) {
-      uip_listenports[c] = port;
-      return;
-    }
+  u16_t offset, len;
+  u8_t hlen, id[REASS_IDLEN];
+
+  hlen = (BUF->vhl & 0x0f) * 4;
+  len = (BUF->len[0] << 8) + BUF->len[1] - hlen;
+  offset = (((BUF->ipoffset[0] & 0x1f) << 8) + BUF->ipoffset[1]) * 8;
+  id[0] = BUF->ipid[0];
+  id[1] = BUF->ipid[1];
+  id[2] = BUF->proto;
+  id[3] = 0;
+
+  len = reass_add(id, offset, (u8_t *)BUF + hlen, len,
+		  BUF->ipoffset[0] & IP_MF);
+  if(len == 0) {
+    return 0;
   }
+
+  len += UIP_IPH_LEN;
+  BUF->vhl = 0x45;
+  BUF->ipoffset[0] = BUF->ipoffset[1] = 0;
+  BUF->len[0] = len >> 8;
+  BUF->len[1] = len & 0xff;
+  BUF->ipchksum = 0;
+  BUF->ipchksum = ~(uip_ipchksum());
+  return len;
 }
+#endif /* !UIP_CONF_IPV6 */
+#endif /* UIP_REASSEMBLY */
+#if UIP_CONF_IPV6
 /*---------------------------------------------------------------------------*/
-/* XXX: IP fragment reassembly: not well-tested. */
+/* IPv6 extension headers. */
+#define IP6_HOPOPTS   0
+#define IP6_ROUTING   43
+#define IP6_FRAGMENT  44
+#define IP6_DSTOPTS   60
 
-#if UIP_REASSEMBLY && !UIP_CONF_IPV6
-#define UIP_REASS_BUFSIZE (UIP_BUFSIZE - UIP_LLH_LEN)
-static u8_t uip_reassbuf[UIP_REASS_BUFSIZE];
-static u8_t uip_reassbitmap[UIP_REASS_BUFSIZE / (8 * 8)];
-static const u8_t bitmap_bits[8] = {0xff, 0x7f, 0x3f, 0x1f,
-				    0x0f, 0x07, 0x03, 0x01};
-static u16_t uip_reasslen;
-static u8_t uip_reassflags;
-#define UIP_REASS_FLAG_LASTFRAG 0x01
-static u8_t uip_reasstmr;
+#define IP6_OPT_PAD1  0
 
-#define IP_MF   0x20
+/* The most extension headers that are walked through in a packet. */
+#define IP6_EXTHDRS_MAX 8
 
+/* Check the options of a hop-by-hop or destination options header.
+   Options that we do not know may only be skipped if the two high
+   bits of their type are zero; otherwise the packet is discarded. */
 static u8_t
-uip_reass(void)
+ip6_options(const u8_t *hdr, u16_t len)
 {
-  u16_t offset, len;
   u16_t i;
 
-  /* If ip_reasstmr is zero, no packet is present in the buffer, so we
-     write the IP header of the fragment into the reassembly
-     buffer. The timer is updated with the maximum age. */
-  if(uip_reasstmr == 0) {
-    memcpy(uip_reassbuf, &BUF->vhl, UIP_IPH_LEN);
-    uip_reasstmr = UIP_REASS_MAXAGE;
-    uip_reassflags = 0;
-    /* Clear the bitmap. */
-    memset(uip_reassbitmap, 0, sizeof(uip_reassbitmap));
-  }
-
-  /* Check if the incoming fragment matches the one currently present
-     in the reasembly buffer. If so, we proceed with copying the
-     fragment into the buffer. */
-  if(BUF->srcipaddr[0] == FBUF->srcipaddr[0] &&
-     BUF->srcipaddr[1] == FBUF->srcipaddr[1] &&
-     BUF->destipaddr[0] == FBUF->destipaddr[0] &&
-     BUF->destipaddr[1] == FBUF->destipaddr[1] &&
-     BUF->ipid[0] == FBUF->ipid[0] &&
-     BUF->ipid[1] == FBUF->ipid[1]) {
-
-    len = (BUF->len[0] << 8) + BUF->len[1] - (BUF->vhl & 0x0f) * 4;
-    offset = (((BUF->ipoffset[0] & 0x3f) << 8) + BUF->ipoffset[1]) * 8;
-
-    /* If the offset or the offset + fragment length overflows the
-       reassembly buffer, we discard the entire packet. */
-    if(offset > UIP_REASS_BUFSIZE ||
-       offset + len > UIP_REASS_BUFSIZE) {
-      uip_reasstmr = 0;
-      goto nullreturn;
-    }
-
-    /* Copy the fragment into the reassembly buffer, at the right
-       offset. */
-    memcpy(&uip_reassbuf[UIP_IPH_LEN + offset],
-	   (char *)BUF + (int)((BUF->vhl & 0x0f) * 4),
-	   len);
-      
-    /* Update the bitmap. */
-    if(offset / (8 * 8) == (offset + len) / (8 * 8)) {
-      /* If the two endpoints are in the same byte, we only update
-	 that byte. */
-	     
-      uip_reassbitmap[offset / (8 * 8)] |=
-	     bitmap_bits[(offset / 8 ) & 7] &
-	     ~bitmap_bits[((offset + len) / 8 ) & 7];
+  i = 2;
+  while(i < len) {
+    if(hdr[i] == IP6_OPT_PAD1) {
+      ++i;
+    } else if(i + 2 > len || i + 2 + hdr[i + 1] > len ||
+	      (hdr[i] & 0xc0) != 0) {
+      return 0;
     } else {
-      /* If the two endpoints are in different bytes, we update the
-	 bytes in the endpoints and fill the stuff inbetween with
-	 0xff. */
-      uip_reassbitmap[offset / (8 * 8)] |=
-	bitmap_bits[(offset / 8 ) & 7];
-      for(i = 1 + offset / (8 * 8); i < (offset + len) / (8 * 8); ++i) {
-	uip_reassbitmap[i] = 0xff;
-      }
-      uip_reassbitmap[(offset + len) / (8 * 8)] |=
-	~bitmap_bits[((offset + len) / 8 ) & 7];
+      i += 2 + hdr[i + 1];
     }
-    
-    /* If this fragment has the More Fragments flag set to zero, we
-       know that this is the last fragment, so we can calculate the
-       size of the entire packet. We also set the
-       IP_REASS_FLAG_LASTFRAG flag to indicate that we have received
-       the final fragment. */
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Walk through the extension headers of the IPv6 packet in uip_buf,
+   reassembling it if it is a fragment, and move the upper layer
+   header down behind the IPv6 header, so that the rest of
+   uip_process() sees the packet as if it had no extension headers.
+   Returns the new length of the packet, or zero if it should be
+   dropped or is a fragment of a datagram that is not yet complete. */
+static u16_t
+ip6_exthdrs(void)
+{
+  u8_t *hdr, nh, n;
+  u16_t off, hlen;
+#if UIP_REASSEMBLY
+  u16_t offset;
+#endif /* UIP_REASSEMBLY */
 
-    if((BUF->ipoffset[0] & IP_MF) == 0) {
-      uip_reassflags |= UIP_REASS_FLAG_LASTFRAG;
-      uip_reasslen = offset + len;
+  off = UIP_IPH_LEN;
+  nh = BUF->proto;
+  for(n = 0; ; ++n) {
+    if(nh != IP6_HOPOPTS && nh != IP6_ROUTING &&
+       nh != IP6_FRAGMENT && nh != IP6_DSTOPTS) {
+      break;
     }
-    
-    /* Finally, we check if we have a full packet in the buffer. We do
-       this by checking if we have the last fragment and if all bits
-       in the bitmap are set. */
-    if(uip_reassflags & UIP_REASS_FLAG_LASTFRAG) {
-      /* Check all bytes up to and including all but the last byte in
-	 the bitmap. */
-      for(i = 0; i < uip_reasslen / (8 * 8) - 1; ++i) {
-	if(uip_reassbitmap[i] != 0xff) {
-	  goto nullreturn;
-	}
+    hdr = &uip_buf[UIP_LLH_LEN + off];
+    /* The hop-by-hop options header may only come first. */
+    if(n == IP6_EXTHDRS_MAX || off + 8 > uip_len ||
+       (nh == IP6_HOPOPTS && off != UIP_IPH_LEN)) {
+      return 0;
+    }
+    hlen = nh == IP6_FRAGMENT? 8: (hdr[1] + 1) * 8;
+    if(off + hlen > uip_len) {
+      return 0;
+    }
+
+    if(nh == IP6_HOPOPTS || nh == IP6_DSTOPTS) {
+      if(!ip6_options(hdr, hlen)) {
+	return 0;
+      }
+    } else if(nh == IP6_ROUTING) {
+      /* We are not a router, so the packet must have reached its
+	 final destination. */
+      if(hdr[3] != 0) {
+	return 0;
+      }
+    } else if((hdr[2] | (hdr[3] & 0xf9)) != 0) {
+      /* A fragment. The headers before it have been dealt with, so
+	 they are dropped and the fragment header is handed to the
+	 reassembly with the IPv6 header in front of it. */
+#if UIP_REASSEMBLY
+      /* Fragments that are not for us are dropped before they take
+	 up a reassembly context. The check is the same as the one
+	 uip_process() makes on whole packets. */
+      if(!uip_ipaddr_cmp(uip_hostaddr, all_zeroes_addr) &&
+	 !uip_ipaddr_cmp(BUF->destipaddr, uip_hostaddr) &&
+	 BUF->destipaddr[0] != HTONS(0xff02)) {
+	UIP_STAT(++uip_stat.ip.drop);
+	return 0;
+      }
+      if(off > UIP_IPH_LEN) {
+	memmove(&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN], hdr, uip_len - off);
+	uip_len -= off - UIP_IPH_LEN;
+	off = UIP_IPH_LEN;
+	hdr = &uip_buf[UIP_LLH_LEN + off];
       }
-      /* Check the last byte in the bitmap. It should contain just the
-	 right amount of bits. */
-      if(uip_reassbitmap[uip_reasslen / (8 * 8)] !=
-	 (u8_t)~bitmap_bits[uip_reasslen / 8 & 7]) {
-	goto nullreturn;
+      BUF->proto = hdr[0];
+      offset = ((hdr[2] << 8) | hdr[3]) & 0xfff8;
+      uip_len = reass_add(&hdr[4], offset, hdr + 8, uip_len - off - 8,
+			  hdr[3] & 1);
+      if(uip_len == 0) {
+	return 0;
       }
+      uip_len += UIP_IPH_LEN;
+      nh = BUF->proto;
+      continue;
+#else /* UIP_REASSEMBLY */
+      UIP_STAT(++uip_stat.ip.drop);
+      UIP_STAT(++uip_stat.ip.fragerr);
+      UIP_LOG("ip: fragment dropped.");
+      return 0;
+#endif /* UIP_REASSEMBLY */
+    }
+    /* An atomic fragment (offset zero and no more fragments) is
+       handled like any other extension header. */
+    nh = hdr[0];
+    off += hlen;
+  }
 
-      /* If we have come this far, we have a full packet in the
-	 buffer, so we allocate a pbuf and copy the packet into it. We
-	 also reset the timer. */
-      uip_reasstmr = 0;
-      memcpy(BUF, FBUF, uip_reasslen);
+  if(off > UIP_IPH_LEN) {
+    memmove(&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN], &uip_buf[UIP_LLH_LEN + off],
+	    uip_len - off);
+    uip_len -= off - UIP_IPH_LEN;
+  }
+  BUF->proto = nh;
+  BUF->len[0] = (uip_len - UIP_IPH_LEN) >> 8;
+  BUF->len[1] = (uip_len - UIP_IPH_LEN) & 0xff;
+  return uip_len;
+}
+#endif /* UIP_CONF_IPV6 */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_TIMER_WHEEL
+void
+uip_wheel_tick(void)
+{
+  register struct uip_conn *conn, *next;
 
-      /* Pretend to be a "normal" (i.e., not fragmented) IP packet
-	 from now on. */
-      BUF->ipoffset[0] = BUF->ipoffset[1] = 0;
-      BUF->len[0] = uip_reasslen >> 8;
-      BUF->len[1] = uip_reasslen & 0xff;
-      BUF->ipchksum = 0;
-      BUF->ipchksum = ~(uip_ipchksum());
+  ++wheel_ticks;
 
-      return uip_reasslen;
+#if UIP_REASSEMBLY
+  reass_tick();
+#endif /* UIP_REASSEMBLY */
+#if UIP_READY_LIST
+  /* The budget of the ready list starts over on every tick. */
+  ready_round = 0;
+#endif /* UIP_READY_LIST */
+  /* Increase the initial sequence number. */
+  if(++iss[3] == 0) {
+    if(++iss[2] == 0) {
+      if(++iss[1] == 0) {
+	++iss[0];
+      }
     }
   }
 
- nullreturn:
-  return 0;
+  /* Move the connections that expire on this tick to the list of
+     expired connections. Connections that expire on a later turn of
+     the wheel are left in the slot. */
+  for(conn = wheel[TW_SLOT(wheel_ticks)]; conn != NULL; conn = next) {
+    next = conn->twnext;
+    if((int)(conn->twexpire - wheel_ticks) <= 0) {
+      wheel_unlink(conn);
+      wheel_link(&wheel_expired, conn);
+    }
+  }
 }
-#endif /* UIP_REASSEMBLY */
+#endif /* UIP_TCP_TIMER_WHEEL */
 /*---------------------------------------------------------------------------*/
 static void
 uip_add_rcv_nxt(u16_t n)
@@ -689,20 +3433,53 @@ void
 uip_process(u8_t flag)
 {
   register struct uip_conn *uip_connr = uip_conn;
+#if UIP_TCP_FASTOPEN
+  u8_t *tfoopt;
+#endif /* UIP_TCP_FASTOPEN */
+
+#if UIP_TCP_TIMER_WHEEL
+  timed_conn = NULL;
+#endif /* UIP_TCP_TIMER_WHEEL */
+#if TCP_SPLIT
+  lso_data = NULL;
+  lso_left = 0;
+#endif /* TCP_SPLIT */
 
 #if UIP_UDP
   if(flag == UIP_UDP_SEND_CONN) {
     goto udp_send;
   }
 #endif /* UIP_UDP */
+#if UIP_IGMP
+  if(flag == UIP_IGMP_TIMER) {
+    igmp_periodic();
+    uip_flags = 0;
+    return;
+  }
+#endif /* UIP_IGMP */
   
   uip_sappdata = uip_appdata = &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN];
 
   /* Check if we were invoked because of a poll request for a
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
+#if UIP_TCP_TIMER_WHEEL
+    timed_conn = uip_connr;
+    wheel_sync(uip_connr, 0);
+#endif /* UIP_TCP_TIMER_WHEEL */
+#if UIP_PACING
+    if(uip_connr->pacer.held) {
+      goto pace_release;
+    }
+#endif /* UIP_PACING */
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
        !uip_outstanding(uip_connr)) {
+#if UIP_READY_LIST
+	/* The connection is polled now, so it no longer needs to be
+	   on the ready list. The application may mark it again. A
+	   connection that is not polled here keeps its mark. */
+	ready_unlink(uip_connr);
+#endif /* UIP_READY_LIST */
 	uip_flags = UIP_POLL;
 	UIP_APPCALL();
 	goto appsend;
@@ -711,11 +3488,20 @@ uip_process(u8_t flag)
     
     /* Check if we were invoked because of the perodic timer fireing. */
   } else if(flag == UIP_TIMER) {
+#if UIP_TCP_TIMER_WHEEL
+    /* The per-tick work is done by uip_wheel_tick(), so we only need
+       to catch up with the ticks that have passed since the timer of
+       this connection was armed. */
+    timed_conn = uip_connr;
+    wheel_sync(uip_connr, 1);
+#else /* UIP_TCP_TIMER_WHEEL */
 #if UIP_REASSEMBLY
-    if(uip_reasstmr != 0) {
-      --uip_reasstmr;
-    }
+    reass_tick();
 #endif /* UIP_REASSEMBLY */
+#if UIP_READY_LIST
+    /* The budget of the ready list starts over on every tick. */
+    ready_round = 0;
+#endif /* UIP_READY_LIST */
     /* Increase the initial sequence number. */
     if(++iss[3] == 0) {
       if(++iss[2] == 0) {
@@ -724,6 +3510,7 @@ uip_process(u8_t flag)
 	}
       }
     }
+#endif /* UIP_TCP_TIMER_WHEEL */
 
     /* Reset the length variables. */
     uip_len = 0;
@@ -737,9 +3524,29 @@ uip_process(u8_t flag)
        uip_connr->tcpstateflags == UIP_FIN_WAIT_2) {
       ++(uip_connr->timer);
       if(uip_connr->timer == UIP_TIME_WAIT_TIMEOUT) {
-	uip_connr->tcpstateflags = UIP_CLOSED;
+	conn_free(uip_connr);
       }
     } else if(uip_connr->tcpstateflags != UIP_CLOSED) {
+#if UIP_PACING
+      if(uip_connr->pacer.held) {
+	/* Data that has been held back because the connection was
+	   over its rate is sent when the bucket has refilled. The
+	   retransmission timer does not run in the meantime. */
+      pace_release:
+	if(!pace_refill(&uip_connr->pacer)) {
+#if UIP_READY_LIST
+	  uip_conn_ready(uip_connr);
+#endif /* UIP_READY_LIST */
+	  goto drop;
+	}
+	uip_connr->pacer.held = 0;
+	uip_connr->timer = uip_connr->rto;
+	uip_slen = 0;
+	uip_flags = UIP_REXMIT;
+	UIP_APPCALL();
+	goto apprexmit;
+      }
+#endif /* UIP_PACING */
       /* If the connection has outstanding data, we increase the
 	 connection's timer and see if it has reached the RTO value
 	 in which case we retransmit. */
@@ -749,7 +3556,7 @@ uip_process(u8_t flag)
 	     ((uip_connr->tcpstateflags == UIP_SYN_SENT ||
 	       uip_connr->tcpstateflags == UIP_SYN_RCVD) &&
 	      uip_connr->nrtx == UIP_MAXSYNRTX)) {
-	    uip_connr->tcpstateflags = UIP_CLOSED;
+	    conn_free(uip_connr);
 
 	    /* We call UIP_APPCALL() with uip_flags set to
 	       UIP_TIMEDOUT to inform the application that the
@@ -762,6 +3569,32 @@ uip_process(u8_t flag)
 	    goto tcp_send_nodata;
 	  }
 
+#if UIP_TCP_PERSIST
+	  if(uip_connr->persist != 0) {
+	    /* The data is held back by a closed window, so instead of
+	       retransmitting it we probe the window. */
+	    uip_connr->timer = UIP_RTO << uip_connr->persist;
+	    if(uip_connr->persist < 4) {
+	      ++(uip_connr->persist);
+	    }
+	    ++(uip_connr->nrtx);
+	    probe = 1;
+	    goto tcp_send_ack;
+	  }
+#endif /* UIP_TCP_PERSIST */
+
+#if UIP_PMTUD
+	  /* If a full-sized segment keeps timing out, a router on the
+	     path may be dropping it without the ICMP message getting
+	     through to us. We fall back to a smaller MSS. */
+	  if(uip_connr->nrtx == UIP_PMTU_BLACKHOLE_RTX &&
+	     (uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+	     uip_connr->len > UIP_PMTU_BASE_MSS) {
+	    pmtu_learn(&uip_connr->ripaddr,
+		       UIP_PMTU_BASE_MSS + UIP_IPTCPH_LEN);
+	  }
+#endif /* UIP_PMTUD */
+
 	  /* Exponential backoff. */
 	  uip_connr->timer = UIP_RTO << (uip_connr->nrtx > 4?
 					 4:
@@ -779,12 +3612,46 @@ uip_process(u8_t flag)
 	  case UIP_SYN_RCVD:
 	    /* In the SYN_RCVD state, we should retransmit our
                SYNACK. */
+#if UIP_TCP_FASTOPEN
+	    if(uip_connr->len > 1) {
+	      /* The SYNACK carried data from the application, which
+		 it must give us again. */
+	      uip_sappdata = uip_appdata =
+		&uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN + TCP_OPT_MSS_LEN];
+	      uip_flags = UIP_REXMIT;
+	      UIP_APPCALL();
+	      uip_slen = uip_connr->len - 1;
+	    }
+#endif /* UIP_TCP_FASTOPEN */
 	    goto tcp_send_synack;
 	    
 #if UIP_ACTIVE_OPEN
 	  case UIP_SYN_SENT:
 	    /* In the SYN_SENT state, we retransmit out SYN. */
 	    BUF->flags = 0;
+#if UIP_TCP_FASTOPEN
+	    if(uip_connr->nrtx == 1 && uip_connr->fastopen == TFO_COOKIE &&
+	       tfo_cache_find(&uip_connr->ripaddr, &c) != NULL) {
+	      /* We have a cookie for the server, so the first SYN can
+		 carry data. The application is told that it is
+		 connected and its data is put after the options. */
+	      tmp16 = TCP_OPT_MSS_LEN +
+		tfo_options(uip_connr, &BUF->optdata[TCP_OPT_MSS_LEN]);
+	      uip_sappdata = uip_appdata =
+		&uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN + tmp16];
+	      uip_connr->fastopen = TFO_DATA;
+	      uip_flags = UIP_CONNECTED;
+	      UIP_APPCALL();
+	      if(uip_flags & UIP_ABORT) {
+		conn_free(uip_connr);
+		goto drop;
+	      }
+	      if(uip_slen > uip_connr->mss - tmp16) {
+		uip_slen = uip_connr->mss - tmp16;
+	      }
+	      uip_connr->len = 1 + uip_slen;
+	    }
+#endif /* UIP_TCP_FASTOPEN */
 	    goto tcp_send_syn;
 #endif /* UIP_ACTIVE_OPEN */
 	    
@@ -804,13 +3671,53 @@ uip_process(u8_t flag)
 	    goto tcp_send_finack;
 	    
 	  }
+#if UIP_TCP_TLP
+	} else if(tlp_armed(uip_connr) &&
+		  uip_connr->rto - uip_connr->timer >= TLP_PTO(uip_connr)) {
+	  /* Tail loss probe. The data in transit has not been
+	     acknowledged within two round-trip times, which most
+	     likely means that the last segment was lost and there
+	     will be no duplicate ACKs to tell us. We retransmit it
+	     without waiting for the retransmission timer, and without
+	     backing off the timer. */
+	  uip_connr->probed = 1;
+	  UIP_STAT(++uip_stat.tcp.rexmit);
+	  uip_flags = UIP_REXMIT;
+	  UIP_APPCALL();
+	  goto apprexmit;
+#endif /* UIP_TCP_TLP */
 	}
       } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+#if UIP_TCP_KEEPALIVE
+	/* If the connection has been idle for too long, we probe the
+	   remote host, and give up if it does not answer. With the
+	   timer wheel, the connection also comes here when data in its
+	   send buffer is due, which is not a keepalive tick. */
+	if(uip_connr->kaidle != 0 &&
+#if UIP_TCP_TIMER_WHEEL
+	   uip_connr->twkind == TW_KA &&
+#endif /* UIP_TCP_TIMER_WHEEL */
+	   --(uip_connr->katimer) == 0) {
+	  if(uip_connr->kaprobes == uip_connr->kacnt) {
+	    conn_free(uip_connr);
+	    uip_flags = UIP_TIMEDOUT;
+	    UIP_APPCALL();
+	    BUF->flags = TCP_RST | TCP_ACK;
+	    goto tcp_send_nodata;
+	  }
+	  ++(uip_connr->kaprobes);
+	  uip_connr->katimer = uip_connr->kaintvl;
+	  probe = 1;
+	  goto tcp_send_ack;
+	}
+#endif /* UIP_TCP_KEEPALIVE */
+#if !UIP_READY_LIST
 	/* If there was no need for a retransmission, we poll the
            application for new data. */
 	uip_flags = UIP_POLL;
 	UIP_APPCALL();
 	goto appsend;
+#endif /* !UIP_READY_LIST */
       }
     }
     goto drop;
@@ -818,6 +3725,13 @@ uip_process(u8_t flag)
 #if UIP_UDP
   if(flag == UIP_UDP_TIMER) {
     if(uip_udp_conn->lport != 0) {
+#if UIP_PACING
+      /* A paced connection is not polled until it may send again. */
+      if(uip_udp_conn->pacer.rate != 0 &&
+	 !pace_refill(&uip_udp_conn->pacer)) {
+	goto drop;
+      }
+#endif /* UIP_PACING */
       uip_conn = NULL;
       uip_sappdata = uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
       uip_len = uip_slen = 0;
@@ -836,6 +3750,20 @@ uip_process(u8_t flag)
   /* Start of IP input header processing code. */
   
 #if UIP_CONF_IPV6
+#if UIP_DUAL_STACK
+  /* IPv4 packets are taken in by ip4_input(), which hands TCP and UDP
+     on as IPv6 packets between IPv4-mapped addresses. */
+  if((BUF->vtc & 0xf0) == 0x40) {
+    c = ip4_input();
+    if(c == 0) {
+      UIP_STAT(++uip_stat.ip.drop);
+      goto drop;
+    } else if(c == 2) {
+      goto send;
+    }
+    goto ip_dispatch;
+  }
+#endif /* UIP_DUAL_STACK */
   /* Check validity of the IP header. */
   if((BUF->vtc & 0xf0) != 0x60)  { /* IP version and header length. */
     UIP_STAT(++uip_stat.ip.drop);
@@ -845,7 +3773,13 @@ uip_process(u8_t flag)
   }
 #else /* UIP_CONF_IPV6 */
   /* Check validity of the IP header. */
+#if UIP_IGMP
+  /* IGMP messages carry a router alert option. */
+  if(BUF->vhl != 0x45 &&
+     (BUF->vhl != 0x46 || BUF->proto != UIP_PROTO_IGMP)) {
+#else /* UIP_IGMP */
   if(BUF->vhl != 0x45)  { /* IP version and header length. */
+#endif /* UIP_IGMP */
     UIP_STAT(++uip_stat.ip.drop);
     UIP_STAT(++uip_stat.ip.vhlerr);
     UIP_LOG("ip: invalid version or header length.");
@@ -894,6 +3828,13 @@ uip_process(u8_t flag)
     goto drop;
 #endif /* UIP_REASSEMBLY */
   }
+#else /* UIP_CONF_IPV6 */
+  /* Extension headers are dealt with, and fragments reassembled,
+     before the packet is passed on. */
+  uip_len = ip6_exthdrs();
+  if(uip_len == 0) {
+    goto drop;
+  }
 #endif /* UIP_CONF_IPV6 */
 
   if(uip_ipaddr_cmp(uip_hostaddr, all_zeroes_addr)) {
@@ -925,6 +3866,15 @@ uip_process(u8_t flag)
     
     /* Check if the packet is destined for our IP address. */
 #if !UIP_CONF_IPV6
+#if UIP_IGMP
+    if(uip_ipaddr_mcast(BUF->destipaddr)) {
+      if(BUF->proto == UIP_PROTO_TCP ||
+	 !igmp_member(&BUF->destipaddr)) {
+	UIP_STAT(++uip_stat.ip.drop);
+	goto drop;
+      }
+    } else
+#endif /* UIP_IGMP */
     if(!uip_ipaddr_cmp(BUF->destipaddr, uip_hostaddr)) {
       UIP_STAT(++uip_stat.ip.drop);
       goto drop;
@@ -944,8 +3894,14 @@ uip_process(u8_t flag)
   }
 
 #if !UIP_CONF_IPV6
+#if UIP_IGMP
+  /* The header of an IGMP message with options is checked by
+     igmp_input(). */
+  if(BUF->vhl == 0x45 && uip_ipchksum() != 0xffff) {
+#else /* UIP_IGMP */
   if(uip_ipchksum() != 0xffff) { /* Compute and check the IP header
 				    checksum. */
+#endif /* UIP_IGMP */
     UIP_STAT(++uip_stat.ip.drop);
     UIP_STAT(++uip_stat.ip.chkerr);
     UIP_LOG("ip: bad checksum.");
@@ -953,6 +3909,9 @@ uip_process(u8_t flag)
   }
 #endif /* UIP_CONF_IPV6 */
 
+#if UIP_DUAL_STACK
+ ip_dispatch:
+#endif /* UIP_DUAL_STACK */
   if(BUF->proto == UIP_PROTO_TCP) { /* Check for TCP packet. If so,
 				       proceed with TCP input
 				       processing. */
@@ -965,6 +3924,13 @@ uip_process(u8_t flag)
   }
 #endif /* UIP_UDP */
 
+#if UIP_IGMP
+  if(BUF->proto == UIP_PROTO_IGMP) {
+    igmp_input((BUF->vhl & 0x0f) << 2);
+    goto drop;
+  }
+#endif /* UIP_IGMP */
+
 #if !UIP_CONF_IPV6
   /* ICMPv4 processing code follows. */
   if(BUF->proto != UIP_PROTO_ICMP) { /* We only allow ICMP packets from
@@ -974,11 +3940,60 @@ uip_process(u8_t flag)
     UIP_LOG("ip: neither tcp nor icmp.");
     goto drop;
   }
-
-#if UIP_PINGADDRCONF
- icmp_input:
-#endif /* UIP_PINGADDRCONF */
-  UIP_STAT(++uip_stat.icmp.recv);
+
+#if UIP_PINGADDRCONF
+ icmp_input:
+#endif /* UIP_PINGADDRCONF */
+  UIP_STAT(++uip_stat.icmp.recv);
+
+#if UIP_PMTUD
+  if(ICMPBUF->type == ICMP_DEST_UNREACH &&
+     ICMPBUF->icode == ICMP_FRAG_NEEDED) {
+    /* A segment we sent was too large for a link on the path. The
+       message holds the IP header and the first eight bytes of the
+       TCP header of the segment, and we only believe it if it matches
+       the segment that a connection has in flight. */
+    if(uip_len < UIP_IPH_LEN + 8 + UIP_IPH_LEN + 8 ||
+       ICMPTCPBUF->vhl != 0x45 ||
+       ICMPTCPBUF->proto != UIP_PROTO_TCP ||
+       !uip_ipaddr_cmp(ICMPTCPBUF->srcipaddr, uip_hostaddr)) {
+      goto drop;
+    }
+    tmp16 = ntohs(ICMPBUF->seqno);
+    if(tmp16 == 0) {
+      tmp16 = pmtu_plateau((ICMPTCPBUF->len[0] << 8) + ICMPTCPBUF->len[1]);
+    } else if(tmp16 < PMTU_MIN) {
+      tmp16 = PMTU_MIN;
+    }
+    for(uip_connr = &uip_conns[0];
+	uip_connr < &uip_conns[UIP_CONNS]; ++uip_connr) {
+      if(uip_connr->tcpstateflags != UIP_CLOSED &&
+	 uip_outstanding(uip_connr) &&
+	 ICMPTCPBUF->srcport == uip_connr->lport &&
+	 ICMPTCPBUF->destport == uip_connr->rport &&
+	 uip_ipaddr_cmp(ICMPTCPBUF->destipaddr, uip_connr->ripaddr) &&
+	 ICMPTCPBUF->seqno[0] == uip_connr->snd_nxt[0] &&
+	 ICMPTCPBUF->seqno[1] == uip_connr->snd_nxt[1] &&
+	 ICMPTCPBUF->seqno[2] == uip_connr->snd_nxt[2] &&
+	 ICMPTCPBUF->seqno[3] == uip_connr->snd_nxt[3]) {
+	if(tmp16 - UIP_IPTCPH_LEN < uip_connr->mss) {
+	  pmtu_learn(&uip_connr->ripaddr, tmp16);
+	  if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+	    /* We retransmit right away with the smaller MSS. */
+	    uip_conn = uip_connr;
+	    uip_sappdata = uip_appdata = &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN];
+	    uip_len = uip_slen = 0;
+	    uip_flags = UIP_REXMIT;
+	    UIP_APPCALL();
+	    goto apprexmit;
+	  }
+	}
+	break;
+      }
+    }
+    goto drop;
+  }
+#endif /* UIP_PMTUD */
 
   /* ICMP echo (i.e., ping) processing. This is simple, we only change
      the ICMP type from ECHO to ECHO_REPLY and adjust the ICMP
@@ -1106,6 +4121,12 @@ uip_process(u8_t flag)
 #endif /* UIP_UDP_CHECKSUMS */
 
   /* Demultiplex this UDP packet between the UDP "connections". */
+#if UIP_UDP_HASH
+  uip_udp_conn = udp_lookup();
+  if(uip_udp_conn != NULL) {
+    goto udp_found;
+  }
+#else /* UIP_UDP_HASH */
   for(uip_udp_conn = &uip_udp_conns[0];
       uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
       ++uip_udp_conn) {
@@ -1122,10 +4143,12 @@ uip_process(u8_t flag)
         UDPBUF->srcport == uip_udp_conn->rport) &&
        (uip_ipaddr_cmp(uip_udp_conn->ripaddr, all_zeroes_addr) ||
 	uip_ipaddr_cmp(uip_udp_conn->ripaddr, all_ones_addr) ||
-	uip_ipaddr_cmp(BUF->srcipaddr, uip_udp_conn->ripaddr))) {
+	uip_ipaddr_cmp(BUF->srcipaddr, uip_udp_conn->ripaddr)) &&
+       UDP_GROUP_OK(uip_udp_conn)) {
       goto udp_found;
     }
   }
+#endif /* UIP_UDP_HASH */
   UIP_LOG("udp: no matching connection found");
   goto drop;
   
@@ -1133,12 +4156,29 @@ uip_process(u8_t flag)
   uip_conn = NULL;
   uip_flags = UIP_NEWDATA;
   uip_sappdata = uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+#if UIP_UDP_RXQ
+  if(uip_udp_conn->rxbuf != NULL) {
+    /* The datagram is kept in the receive queue until the
+       application reads it with uip_udp_recv(). */
+    if(!udpq_put(uip_udp_conn)) {
+      UIP_STAT(++uip_stat.udp.drop);
+      UIP_STAT(++uip_stat.udp.qdrop);
+    }
+    goto drop;
+  }
+#endif /* UIP_UDP_RXQ */
   uip_slen = 0;
   UIP_UDP_APPCALL();
  udp_send:
   if(uip_slen == 0) {
     goto drop;
   }
+#if UIP_PACING
+  if(uip_udp_conn->pacer.rate != 0) {
+    pace_refill(&uip_udp_conn->pacer);
+    pace_take(&uip_udp_conn->pacer, uip_slen);
+  }
+#endif /* UIP_PACING */
   uip_len = uip_slen + UIP_IPUDPH_LEN;
 
 #if UIP_CONF_IPV6
@@ -1160,7 +4200,7 @@ uip_process(u8_t flag)
   BUF->srcport  = uip_udp_conn->lport;
   BUF->destport = uip_udp_conn->rport;
 
-  uip_ipaddr_copy(BUF->srcipaddr, uip_hostaddr);
+  uip_ipaddr_copy(BUF->srcipaddr, UIP_SRCADDR(uip_udp_conn->ripaddr));
   uip_ipaddr_copy(BUF->destipaddr, uip_udp_conn->ripaddr);
    
   uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_IPTCPH_LEN];
@@ -1182,8 +4222,12 @@ uip_process(u8_t flag)
 
   /* Start of TCP input header processing code. */
   
+#if UIP_INPUT_BATCH
+  if(!batch_verified && uip_tcpchksum() != 0xffff) {
+#else /* UIP_INPUT_BATCH */
   if(uip_tcpchksum() != 0xffff) {   /* Compute and check the TCP
 				       checksum. */
+#endif /* UIP_INPUT_BATCH */
     UIP_STAT(++uip_stat.tcp.drop);
     UIP_STAT(++uip_stat.tcp.chkerr);
     UIP_LOG("tcp: bad checksum.");
@@ -1192,8 +4236,26 @@ uip_process(u8_t flag)
   
   
   /* Demultiplex this segment. */
+#if UIP_TCP_FASTPATH
+  /* Segments tend to come in trains, so the connection of the last
+     segment is checked first. */
+  uip_connr = last_conn;
+  if(uip_connr != NULL &&
+     uip_connr->tcpstateflags != UIP_CLOSED &&
+     BUF->destport == uip_connr->lport &&
+     BUF->srcport == uip_connr->rport &&
+     uip_ipaddr_cmp(BUF->srcipaddr, uip_connr->ripaddr)) {
+    goto found;
+  }
+#endif /* UIP_TCP_FASTPATH */
   /* First check any active connections. */
-  for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
+#if UIP_CONN_POOL
+  uip_connr = tcp_lookup(BUF->destport, BUF->srcport, BUF->srcipaddr);
+  if(uip_connr != NULL) {
+    goto found;
+  }
+#else /* UIP_CONN_POOL */
+  for(uip_connr = &uip_conns[0]; uip_connr < &uip_conns[UIP_CONNS];
       ++uip_connr) {
     if(uip_connr->tcpstateflags != UIP_CLOSED &&
        BUF->destport == uip_connr->lport &&
@@ -1202,6 +4264,7 @@ uip_process(u8_t flag)
       goto found;
     }
   }
+#endif /* UIP_CONN_POOL */
 
   /* If we didn't find and active connection that expected the packet,
      either this packet is an old duplicate, or this is a SYN packet
@@ -1268,7 +4331,7 @@ uip_process(u8_t flag)
   
   /* Swap IP addresses. */
   uip_ipaddr_copy(BUF->destipaddr, BUF->srcipaddr);
-  uip_ipaddr_copy(BUF->srcipaddr, uip_hostaddr);
+  uip_ipaddr_copy(BUF->srcipaddr, UIP_SRCADDR(BUF->destipaddr));
   
   /* And send out the RST packet! */
   goto tcp_send_noconn;
@@ -1281,21 +4344,8 @@ uip_process(u8_t flag)
      connections are kept in the same table as used connections, but
      unused ones have the tcpstate set to CLOSED. Also, connections in
      TIME_WAIT are kept track of and we'll use the oldest one if no
-     CLOSED connections are found. Thanks to Eddie C. Dost for a very
-     nice algorithm for the TIME_WAIT search. */
-  uip_connr = 0;
-  for(c = 0; c < UIP_CONNS; ++c) {
-    if(uip_conns[c].tcpstateflags == UIP_CLOSED) {
-      uip_connr = &uip_conns[c];
-      break;
-    }
-    if(uip_conns[c].tcpstateflags == UIP_TIME_WAIT) {
-      if(uip_connr == 0 ||
-	 uip_conns[c].timer > uip_connr->timer) {
-	uip_connr = &uip_conns[c];
-      }
-    }
-  }
+     CLOSED connections are found. */
+  uip_connr = conn_alloc();
 
   if(uip_connr == 0) {
     /* All connections are used already, we drop packet and hope that
@@ -1306,6 +4356,9 @@ uip_process(u8_t flag)
     goto drop;
   }
   uip_conn = uip_connr;
+#if UIP_TCP_TIMER_WHEEL
+  timed_conn = uip_connr;
+#endif /* UIP_TCP_TIMER_WHEEL */
   
   /* Fill in the necessary fields for the new connection. */
   uip_connr->rto = uip_connr->timer = UIP_RTO;
@@ -1316,6 +4369,44 @@ uip_process(u8_t flag)
   uip_connr->rport = BUF->srcport;
   uip_ipaddr_copy(uip_connr->ripaddr, BUF->srcipaddr);
   uip_connr->tcpstateflags = UIP_SYN_RCVD;
+#if UIP_CONN_POOL
+  tcp_hash(uip_connr, 0);
+#endif /* UIP_CONN_POOL */
+#if UIP_TCP_KEEPALIVE
+  uip_connr->kaidle = uip_connr->katimer = UIP_TCP_KEEPALIVE_IDLE;
+  uip_connr->kaintvl = UIP_TCP_KEEPALIVE_INTVL;
+  uip_connr->kacnt = UIP_TCP_KEEPALIVE_CNT;
+  uip_connr->kaprobes = 0;
+#endif /* UIP_TCP_KEEPALIVE */
+#if UIP_LSO
+  uip_connr->wnd = 0;
+#endif /* UIP_LSO */
+#if UIP_TCP_PERSIST
+  uip_connr->persist = 0;
+#endif /* UIP_TCP_PERSIST */
+#if UIP_TCP_RXBUF
+  uip_connr->rxbuf = NULL;
+#endif /* UIP_TCP_RXBUF */
+#if UIP_TCP_TXBUF
+  uip_connr->txbuf = NULL;
+  uip_connr->txclose = 0;
+#endif /* UIP_TCP_TXBUF */
+#if UIP_PACING
+  uip_connr->pacer.rate = 0;
+  uip_connr->pacer.held = 0;
+#endif /* UIP_PACING */
+#if UIP_TCP_TLP
+  uip_connr->probed = 0;
+#endif /* UIP_TCP_TLP */
+#if UIP_TCP_ECN
+  /* The remote host asks for ECN with both ECE and CWR in its SYN. */
+  uip_connr->ecn = (BUF->flags & (TCP_ECE | TCP_CWR)) == (TCP_ECE | TCP_CWR)?
+    ECN_OK: 0;
+  uip_connr->cwnd = 0xffff;
+#if UIP_TCP_ECN_DCTCP
+  uip_connr->alpha = 1024;
+#endif /* UIP_TCP_ECN_DCTCP */
+#endif /* UIP_TCP_ECN */
 
   uip_connr->snd_nxt[0] = iss[0];
   uip_connr->snd_nxt[1] = iss[1];
@@ -1330,6 +4421,13 @@ uip_process(u8_t flag)
   uip_connr->rcv_nxt[0] = BUF->seqno[0];
   uip_add_rcv_nxt(1);
 
+#if UIP_TCP_FASTOPEN
+  uip_connr->fastopen = 0;
+  uip_connr->initialmss = uip_connr->mss = UIP_TCP_MSS;
+  uip_slen = 0;
+  tfoopt = NULL;
+#endif /* UIP_TCP_FASTOPEN */
+
   /* Parse the TCP MSS option, if present. */
   if((BUF->tcpoffset & 0xf0) > 0x50) {
     for(c = 0; c < ((BUF->tcpoffset >> 4) - 5) << 2 ;) {
@@ -1348,8 +4446,19 @@ uip_process(u8_t flag)
 	uip_connr->initialmss = uip_connr->mss =
 	  tmp16 > UIP_TCP_MSS? UIP_TCP_MSS: tmp16;
 	
+#if UIP_TCP_FASTOPEN
+	/* The Fast Open option may follow. */
+	c += TCP_OPT_MSS_LEN;
+#else /* UIP_TCP_FASTOPEN */
 	/* And we are done processing options. */
 	break;
+#endif /* UIP_TCP_FASTOPEN */
+#if UIP_TCP_FASTOPEN
+      } else if(opt == TCP_OPT_FASTOPEN &&
+		uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] >= 2) {
+	tfoopt = &uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + c];
+	c += tfoopt[1];
+#endif /* UIP_TCP_FASTOPEN */
       } else {
 	/* All other options have a length field, so that we easily
 	   can skip past them. */
@@ -1363,6 +4472,52 @@ uip_process(u8_t flag)
     }
   }
   
+#if UIP_PMTUD
+  tmp16 = pmtu_mss(&uip_connr->ripaddr);
+  if(uip_connr->mss > tmp16) {
+    uip_connr->initialmss = uip_connr->mss = tmp16;
+  }
+#endif /* UIP_PMTUD */
+
+#if UIP_TCP_FASTOPEN
+  if(tfoopt != NULL && tfo_keyset) {
+    /* The client supports TCP Fast Open. If it has a valid cookie and
+       has put data in its SYN, we accept the data and let the
+       application answer it in our SYNACK. Otherwise we give the
+       client a cookie for its next connection. When too many
+       connections that were opened this way are still waiting for
+       the ACK of the client, the data is not accepted, so that a
+       flood of SYNs with data cannot take up all connections. The
+       client then sends it again after the handshake. */
+    c = (BUF->tcpoffset >> 4) << 2;
+    uip_len = uip_len - c - UIP_IPH_LEN;
+    if(uip_len > 0 && tfo_pending < UIP_TCP_FASTOPEN_PENDING &&
+       tfo_valid(tfoopt, BUF->srcipaddr)) {
+      uip_connr->fastopen = TFO_RCVD;
+      ++tfo_pending;
+      uip_add_rcv_nxt(uip_len);
+      uip_sappdata = uip_appdata = &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + c];
+      uip_flags = UIP_CONNECTED | UIP_NEWDATA;
+      UIP_APPCALL();
+      if(uip_flags & UIP_ABORT) {
+	uip_slen = 0;
+	conn_free(uip_connr);
+	BUF->flags = TCP_RST | TCP_ACK;
+	goto tcp_send_nodata;
+      }
+      if(uip_slen > 0) {
+	if(uip_slen > uip_connr->mss - TCP_OPT_MSS_LEN) {
+	  uip_slen = uip_connr->mss - TCP_OPT_MSS_LEN;
+	}
+	memmove(&BUF->optdata[TCP_OPT_MSS_LEN], uip_sappdata, uip_slen);
+	uip_connr->len += uip_slen;
+      }
+    } else {
+      uip_connr->fastopen = TFO_COOKIE;
+    }
+  }
+#endif /* UIP_TCP_FASTOPEN */
+
   /* Our response will be a SYNACK. */
 #if UIP_ACTIVE_OPEN
  tcp_send_synack:
@@ -1374,27 +4529,139 @@ uip_process(u8_t flag)
  tcp_send_synack:
   BUF->flags = TCP_SYN | TCP_ACK;
 #endif /* UIP_ACTIVE_OPEN */
+#if UIP_TCP_ECN
+  if(!(BUF->flags & TCP_ACK)) {
+    /* We ask for ECN in our SYN, and agree to it in our SYNACK. */
+    BUF->flags |= TCP_ECE | TCP_CWR;
+  } else if(uip_connr->ecn & ECN_OK) {
+    BUF->flags |= TCP_ECE;
+  }
+#endif /* UIP_TCP_ECN */
   
   /* We send out the TCP Maximum Segment Size option with our
      SYNACK. */
   BUF->optdata[0] = TCP_OPT_MSS;
   BUF->optdata[1] = TCP_OPT_MSS_LEN;
+#if UIP_PMTUD
+  /* Do not let the remote host send segments that will not make it
+     through the path to us. */
+  tmp16 = pmtu_mss(&uip_connr->ripaddr);
+  BUF->optdata[2] = tmp16 >> 8;
+  BUF->optdata[3] = tmp16 & 255;
+#else /* UIP_PMTUD */
   BUF->optdata[2] = (UIP_TCP_MSS) / 256;
   BUF->optdata[3] = (UIP_TCP_MSS) & 255;
+#endif /* UIP_PMTUD */
   uip_len = UIP_IPTCPH_LEN + TCP_OPT_MSS_LEN;
   BUF->tcpoffset = ((UIP_TCPH_LEN + TCP_OPT_MSS_LEN) / 4) << 4;
+#if UIP_TCP_FASTOPEN
+  if(uip_connr->fastopen != 0) {
+    c = tfo_options(uip_connr, &BUF->optdata[TCP_OPT_MSS_LEN]);
+    uip_len += c;
+    BUF->tcpoffset = ((UIP_TCPH_LEN + TCP_OPT_MSS_LEN + c) / 4) << 4;
+  }
+  /* Data that goes out with the SYN or SYNACK follows the options. */
+  uip_len += uip_slen;
+#endif /* UIP_TCP_FASTOPEN */
   goto tcp_send;
 
   /* This label will be jumped to if we found an active connection. */
  found:
   uip_conn = uip_connr;
+#if UIP_TCP_TIMER_WHEEL
+  timed_conn = uip_connr;
+  wheel_sync(uip_connr, 0);
+#endif /* UIP_TCP_TIMER_WHEEL */
+#if UIP_TCP_KEEPALIVE
+  /* The remote host is alive, so the keepalive timer starts over. */
+  uip_connr->katimer = uip_connr->kaidle;
+  uip_connr->kaprobes = 0;
+#endif /* UIP_TCP_KEEPALIVE */
   uip_flags = 0;
+#if UIP_TCP_ECN
+  if(uip_connr->ecn & ECN_OK) {
+#if UIP_TCP_ECN_DCTCP
+    /* Every segment we send echoes the mark of the last segment we
+       received. */
+    uip_connr->ecn &= ~ECN_ECE;
+#else /* UIP_TCP_ECN_DCTCP */
+    /* A mark is echoed until the remote host answers with CWR. */
+    if(BUF->flags & TCP_CWR) {
+      uip_connr->ecn &= ~ECN_ECE;
+    }
+#endif /* UIP_TCP_ECN_DCTCP */
+    if(IP_ECN(BUF) == IP_ECN_CE) {
+      uip_connr->ecn |= ECN_ECE;
+    }
+  }
+#endif /* UIP_TCP_ECN */
+#if UIP_TCP_FASTPATH
+  last_conn = uip_connr;
+
+  /* Header prediction. On an established connection, most segments
+     are either a pure ACK for the data in transit, or the next
+     segment of data when nothing is in transit. If the segment has
+     no options and no other flags than ACK and PSH, and the window
+     does not limit our MSS, these two cases go straight to the
+     application. Everything else takes the slow path below. */
+  if(uip_connr->tcpstateflags == UIP_ESTABLISHED &&
+     (BUF->flags & (TCP_CTL & ~TCP_PSH)) == TCP_ACK &&
+     BUF->tcpoffset == ((UIP_TCPH_LEN / 4) << 4) &&
+     BUF->seqno[0] == uip_connr->rcv_nxt[0] &&
+     BUF->seqno[1] == uip_connr->rcv_nxt[1] &&
+     BUF->seqno[2] == uip_connr->rcv_nxt[2] &&
+     BUF->seqno[3] == uip_connr->rcv_nxt[3] &&
+#if UIP_TCP_PERSIST
+     uip_connr->persist == 0 &&
+#endif /* UIP_TCP_PERSIST */
+     (((u16_t)BUF->wnd[0] << 8) | BUF->wnd[1]) >= uip_connr->initialmss) {
+    uip_len -= UIP_IPTCPH_LEN;
+    if(uip_len == 0) {
+      if(uip_outstanding(uip_connr)) {
+	uip_add32(uip_connr->snd_nxt, uip_connr->len);
+	if(BUF->ackno[0] == uip_acc32[0] &&
+	   BUF->ackno[1] == uip_acc32[1] &&
+	   BUF->ackno[2] == uip_acc32[2] &&
+	   BUF->ackno[3] == uip_acc32[3]) {
+	  tcp_acked(uip_connr);
+	}
+      }
+    } else if(!uip_outstanding(uip_connr) &&
+	      BUF->ackno[0] == uip_connr->snd_nxt[0] &&
+	      BUF->ackno[1] == uip_connr->snd_nxt[1] &&
+	      BUF->ackno[2] == uip_connr->snd_nxt[2] &&
+	      BUF->ackno[3] == uip_connr->snd_nxt[3]
+#if UIP_TCP_RXBUF
+	      && (uip_connr->rxbuf == NULL ||
+		  uip_len <= uip_connr->rxsize - uip_connr->rxlen)
+#endif /* UIP_TCP_RXBUF */
+	      ) {
+#if UIP_TCP_RXBUF
+      if(uip_connr->rxbuf != NULL) {
+	rxbuf_put(uip_connr, uip_appdata, uip_len);
+      }
+#endif /* UIP_TCP_RXBUF */
+      uip_flags = UIP_NEWDATA;
+      uip_add_rcv_nxt(uip_len);
+    }
+    if(uip_flags != 0) {
+      uip_connr->mss = uip_connr->initialmss;
+#if UIP_LSO
+      uip_connr->wnd = ((u16_t)BUF->wnd[0] << 8) | BUF->wnd[1];
+#endif /* UIP_LSO */
+      uip_slen = 0;
+      UIP_APPCALL();
+      goto appsend;
+    }
+    uip_len += UIP_IPTCPH_LEN;
+  }
+#endif /* UIP_TCP_FASTPATH */
   /* We do a very naive form of TCP reset processing; we just accept
      any RST and kill our connection. We should in fact check if the
      sequence number of this reset is wihtin our advertised window
      before we accept the reset. */
   if(BUF->flags & TCP_RST) {
-    uip_connr->tcpstateflags = UIP_CLOSED;
+    conn_free(uip_connr);
     UIP_LOG("tcp: got reset, aborting connection.");
     uip_flags = UIP_ABORT;
     UIP_APPCALL();
@@ -1433,37 +4700,8 @@ uip_process(u8_t flag)
        BUF->ackno[1] == uip_acc32[1] &&
        BUF->ackno[2] == uip_acc32[2] &&
        BUF->ackno[3] == uip_acc32[3]) {
-      /* Update sequence number. */
-      uip_connr->snd_nxt[0] = uip_acc32[0];
-      uip_connr->snd_nxt[1] = uip_acc32[1];
-      uip_connr->snd_nxt[2] = uip_acc32[2];
-      uip_connr->snd_nxt[3] = uip_acc32[3];
-	
-
-      /* Do RTT estimation, unless we have done retransmissions. */
-      if(uip_connr->nrtx == 0) {
-	signed char m;
-	m = uip_connr->rto - uip_connr->timer;
-	/* This is taken directly from VJs original code in his paper */
-	m = m - (uip_connr->sa >> 3);
-	uip_connr->sa += m;
-	if(m < 0) {
-	  m = -m;
-	}
-	m = m - (uip_connr->sv >> 2);
-	uip_connr->sv += m;
-	uip_connr->rto = (uip_connr->sa >> 3) + uip_connr->sv;
-
-      }
-      /* Set the acknowledged flag. */
-      uip_flags = UIP_ACKDATA;
-      /* Reset the retransmission timer. */
-      uip_connr->timer = uip_connr->rto;
-
-      /* Reset length of outstanding data. */
-      uip_connr->len = 0;
+      tcp_acked(uip_connr);
     }
-    
   }
 
   /* Do different things depending on in what state the connection is. */
@@ -1477,9 +4715,33 @@ uip_process(u8_t flag)
        we are waiting for an ACK that acknowledges the data we sent
        out the last time. Therefore, we want to have the UIP_ACKDATA
        flag set. If so, we enter the ESTABLISHED state. */
+#if UIP_TCP_FASTOPEN
+    if(tfo_synacked(uip_connr)) {
+      /* The client has acknowledged our SYN but not the data we sent
+	 with it. The data is retransmitted in the ESTABLISHED
+	 state. */
+      uip_connr->tcpstateflags = UIP_ESTABLISHED;
+      tfo_clear(uip_connr);
+      if(uip_len > 0) {
+	uip_flags = UIP_NEWDATA;
+	uip_add_rcv_nxt(uip_len);
+	uip_slen = 0;
+	UIP_APPCALL();
+	goto appsend;
+      }
+      goto drop;
+    }
+#endif /* UIP_TCP_FASTOPEN */
     if(uip_flags & UIP_ACKDATA) {
       uip_connr->tcpstateflags = UIP_ESTABLISHED;
       uip_flags = UIP_CONNECTED;
+#if UIP_TCP_FASTOPEN
+      if(uip_connr->fastopen == TFO_RCVD) {
+	/* The application already knows that it is connected. */
+	uip_flags = UIP_ACKDATA;
+      }
+      tfo_clear(uip_connr);
+#endif /* UIP_TCP_FASTOPEN */
       uip_connr->len = 0;
       if(uip_len > 0) {
         uip_flags |= UIP_NEWDATA;
@@ -1496,6 +4758,13 @@ uip_process(u8_t flag)
        our SYN. The rcv_nxt is set to sequence number in the SYNACK
        plus one, and we send an ACK. We move into the ESTABLISHED
        state. */
+#if UIP_TCP_FASTOPEN
+    if((BUF->flags & TCP_CTL) == (TCP_SYN | TCP_ACK) &&
+       tfo_synacked(uip_connr)) {
+      /* The server did not accept the data in our SYN. */
+      uip_flags = UIP_ACKDATA;
+    }
+#endif /* UIP_TCP_FASTOPEN */
     if((uip_flags & UIP_ACKDATA) &&
        (BUF->flags & TCP_CTL) == (TCP_SYN | TCP_ACK)) {
 
@@ -1517,8 +4786,25 @@ uip_process(u8_t flag)
 	    uip_connr->initialmss =
 	      uip_connr->mss = tmp16 > UIP_TCP_MSS? UIP_TCP_MSS: tmp16;
 
+#if UIP_TCP_FASTOPEN
+	    /* The Fast Open option may follow. */
+	    c += TCP_OPT_MSS_LEN;
+#else /* UIP_TCP_FASTOPEN */
 	    /* And we are done processing options. */
 	    break;
+#endif /* UIP_TCP_FASTOPEN */
+#if UIP_TCP_FASTOPEN
+	  } else if(opt == TCP_OPT_FASTOPEN &&
+		    uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] >= 2 + 4 &&
+		    uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] <=
+		    2 + TCP_OPT_FASTOPEN_COOKIE_MAX) {
+	    /* The server has given us a cookie to use the next time we
+	       connect to it. */
+	    tfo_cache_store(&uip_connr->ripaddr,
+			    &uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 2 + c],
+			    uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] - 2);
+	    c += uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c];
+#endif /* UIP_TCP_FASTOPEN */
 	  } else {
 	    /* All other options have a length field, so that we easily
 	       can skip past them. */
@@ -1532,11 +4818,47 @@ uip_process(u8_t flag)
 	}
       }
       uip_connr->tcpstateflags = UIP_ESTABLISHED;
+#if UIP_TCP_ECN
+      if((BUF->flags & (TCP_ECE | TCP_CWR)) == TCP_ECE) {
+	/* The server agreed to use ECN. */
+	uip_connr->ecn = ECN_OK;
+      }
+#endif /* UIP_TCP_ECN */
       uip_connr->rcv_nxt[0] = BUF->seqno[0];
       uip_connr->rcv_nxt[1] = BUF->seqno[1];
       uip_connr->rcv_nxt[2] = BUF->seqno[2];
       uip_connr->rcv_nxt[3] = BUF->seqno[3];
       uip_add_rcv_nxt(1);
+#if UIP_TCP_FASTOPEN
+      if(uip_connr->fastopen == TFO_DATA) {
+	/* The application was told that it is connected when the SYN
+	   was sent. */
+	uip_connr->fastopen = 0;
+	uip_slen = 0;
+	/* The server may have sent data with its SYNACK. The data
+	   follows the TCP options. */
+	if(uip_len > 0) {
+	  uip_add_rcv_nxt(uip_len);
+	  uip_appdata = &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN +
+				 ((BUF->tcpoffset >> 4) << 2)];
+	}
+	if(uip_connr->len == 0) {
+	  /* The data in our SYN was acknowledged. */
+	  uip_flags = UIP_ACKDATA | UIP_NEWDATA;
+	  UIP_APPCALL();
+	  goto appsend;
+	}
+	/* Only the SYN was acknowledged, so the application has to
+	   send its data again. */
+	uip_flags = UIP_REXMIT;
+	if(uip_len > 0) {
+	  uip_flags |= UIP_NEWDATA;
+	}
+	UIP_APPCALL();
+	goto apprexmit;
+      }
+      uip_connr->fastopen = 0;
+#endif /* UIP_TCP_FASTOPEN */
       uip_flags = UIP_CONNECTED | UIP_NEWDATA;
       uip_connr->len = 0;
       uip_len = 0;
@@ -1548,7 +4870,7 @@ uip_process(u8_t flag)
     uip_flags = UIP_ABORT;
     UIP_APPCALL();
     /* The connection is closed after we send the RST */
-    uip_conn->tcpstateflags = UIP_CLOSED;
+    conn_free(uip_conn);
     goto reset;
 #endif /* UIP_ACTIVE_OPEN */
     
@@ -1564,10 +4886,23 @@ uip_process(u8_t flag)
     state. We require that there is no outstanding data; otherwise the
     sequence numbers will be screwed up. */
 
+#if UIP_TCP_RXBUF
+    if(uip_connr->rxbuf != NULL &&
+       uip_len > uip_connr->rxsize - uip_connr->rxlen) {
+      /* The data before the FIN does not fit in the receive ring, so
+	 we ignore the FIN until the remote host sends it again. */
+      BUF->flags &= ~TCP_FIN;
+    }
+#endif /* UIP_TCP_RXBUF */
     if(BUF->flags & TCP_FIN && !(uip_connr->tcpstateflags & UIP_STOPPED)) {
       if(uip_outstanding(uip_connr)) {
 	goto drop;
       }
+#if UIP_TCP_RXBUF
+      if(uip_connr->rxbuf != NULL) {
+	rxbuf_put(uip_connr, uip_appdata, uip_len);
+      }
+#endif /* UIP_TCP_RXBUF */
       uip_add_rcv_nxt(1 + uip_len);
       uip_flags |= UIP_CLOSE;
       if(uip_len > 0) {
@@ -1609,8 +4944,23 @@ uip_process(u8_t flag)
        using uip_stop(), we must not accept any data packets from the
        remote host. */
     if(uip_len > 0 && !(uip_connr->tcpstateflags & UIP_STOPPED)) {
+#if UIP_TCP_RXBUF
+      if(uip_connr->rxbuf != NULL) {
+	/* We take as much of the data as there is room for in the
+	   receive ring. The rest is sent again by the remote host. */
+	uip_len = rxbuf_put(uip_connr, uip_appdata, uip_len);
+	if(uip_len == 0 && !(uip_flags & UIP_ACKDATA)) {
+	  goto tcp_send_ack;
+	}
+      }
+      if(uip_len > 0) {
+	uip_flags |= UIP_NEWDATA;
+	uip_add_rcv_nxt(uip_len);
+      }
+#else /* UIP_TCP_RXBUF */
       uip_flags |= UIP_NEWDATA;
       uip_add_rcv_nxt(uip_len);
+#endif /* UIP_TCP_RXBUF */
     }
 
     /* Check if the available buffer space advertised by the other end
@@ -1626,12 +4976,60 @@ uip_process(u8_t flag)
        "persistent timer" and uses the retransmission mechanim.
     */
     tmp16 = ((u16_t)BUF->wnd[0] << 8) + (u16_t)BUF->wnd[1];
+#if UIP_LSO
+    uip_connr->wnd = tmp16;
+#endif /* UIP_LSO */
     if(tmp16 > uip_connr->initialmss ||
        tmp16 == 0) {
       tmp16 = uip_connr->initialmss;
     }
     uip_connr->mss = tmp16;
 
+#if UIP_TCP_PERSIST
+    /* A zero window puts the connection in the persist state, where
+       the timer probes the window instead of retransmitting. Any ACK
+       with a zero window shows that the remote host is alive. When
+       the window opens, data that has been held back is sent at
+       once. */
+    if(BUF->wnd[0] == 0 && BUF->wnd[1] == 0) {
+      if(uip_connr->persist == 0) {
+	uip_connr->persist = 1;
+      }
+      uip_connr->nrtx = 0;
+    } else if(uip_connr->persist != 0) {
+      uip_connr->persist = 0;
+      if(uip_connr->len > 0 && !(uip_flags & UIP_ACKDATA)) {
+	uip_connr->nrtx = 0;
+	uip_connr->timer = uip_connr->rto;
+	uip_flags |= UIP_REXMIT;
+	uip_slen = 0;
+	UIP_APPCALL();
+	goto apprexmit;
+      }
+    }
+#endif /* UIP_TCP_PERSIST */
+
+#if UIP_TCP_TLP
+    /* A pure ACK that covers only part of the data in transit means
+       that the remote host has received the start of it but not the
+       rest. If the data was sent more than a round-trip time ago, the
+       rest is taken to be lost and the data is retransmitted at once,
+       without waiting for the retransmission timer (RACK). Duplicate
+       ACKs and window updates tell us nothing new and are not taken
+       as a sign of loss. */
+    if(uip_len == 0 && (BUF->flags & TCP_ACK) &&
+       uip_outstanding(uip_connr) && !(uip_flags & UIP_ACKDATA) &&
+       tcp_partial_ack(uip_connr) && tlp_armed(uip_connr) &&
+       uip_connr->rto - uip_connr->timer >= RACK_LOST(uip_connr)) {
+      uip_connr->probed = 1;
+      UIP_STAT(++uip_stat.tcp.rexmit);
+      uip_flags = UIP_REXMIT;
+      uip_slen = 0;
+      UIP_APPCALL();
+      goto apprexmit;
+    }
+#endif /* UIP_TCP_TLP */
+
     /* If this packet constitutes an ACK for outstanding data (flagged
        by the UIP_ACKDATA flag, we should call the application since it
        might want to send more data. If the incoming packet had data
@@ -1654,9 +5052,27 @@ uip_process(u8_t flag)
 
     appsend:
       
+#if UIP_TCP_TXBUF
+      if(uip_connr->txbuf != NULL) {
+	if((uip_flags & UIP_CLOSE) && uip_connr->txlen > 0) {
+	  /* The queued data is sent before the connection is
+	     closed. */
+	  uip_connr->txclose = 1;
+	  uip_flags &= ~UIP_CLOSE;
+	} else if(uip_connr->txclose && uip_connr->txlen == 0) {
+	  uip_flags |= UIP_CLOSE;
+	}
+	if(uip_connr->len == 0 && uip_connr->txlen > 0) {
+	  /* The send ring has data that is waiting to be sent. It is
+	     copied into the packet at apprexmit. */
+	  uip_slen = uip_connr->txlen;
+	}
+      }
+#endif /* UIP_TCP_TXBUF */
+
       if(uip_flags & UIP_ABORT) {
 	uip_slen = 0;
-	uip_connr->tcpstateflags = UIP_CLOSED;
+	conn_free(uip_connr);
 	BUF->flags = TCP_RST | TCP_ACK;
 	goto tcp_send_nodata;
       }
@@ -1687,6 +5103,32 @@ uip_process(u8_t flag)
 	  /* The application cannot send more than what is allowed by
 	     the mss (the minumum of the MSS and the available
 	     window). */
+#if UIP_LSO
+	  if(lso_data != NULL) {
+	    /* A large send is only limited by the window. */
+	    tmp16 = uip_connr->wnd > uip_connr->mss?
+	      uip_connr->wnd: uip_connr->mss;
+#if UIP_PACING
+	    /* A paced connection sends bursts no larger than its
+	       bucket. */
+	    if(uip_connr->pacer.rate != 0 &&
+	       tmp16 > uip_connr->pacer.burst) {
+	      tmp16 = uip_connr->pacer.burst > uip_connr->mss?
+		uip_connr->pacer.burst: uip_connr->mss;
+	    }
+#endif /* UIP_PACING */
+#if UIP_TCP_ECN
+	    /* After a congestion signal, the burst is limited by the
+	       congestion window. */
+	    if(tmp16 > uip_connr->cwnd) {
+	      tmp16 = uip_connr->cwnd;
+	    }
+#endif /* UIP_TCP_ECN */
+	    if(uip_slen > tmp16) {
+	      uip_slen = tmp16;
+	    }
+	  } else
+#endif /* UIP_LSO */
 	  if(uip_slen > uip_connr->mss) {
 	    uip_slen = uip_connr->mss;
 	  }
@@ -1705,6 +5147,38 @@ uip_process(u8_t flag)
       uip_connr->nrtx = 0;
     apprexmit:
       uip_appdata = uip_sappdata;
+#if UIP_TCP_TXBUF
+      if(uip_connr->txbuf != NULL && uip_connr->len > 0 &&
+	 (uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+	/* The data in transit is at the head of the send ring, so
+	   uIP can retransmit it without help from the application. */
+	txbuf_get(uip_connr, uip_appdata, uip_connr->len);
+	uip_slen = uip_connr->len;
+      }
+#endif /* UIP_TCP_TXBUF */
+#if UIP_TCP_PERSIST
+      if(uip_connr->persist != 0) {
+	/* The window of the remote host is closed, so data is held
+	   back until it opens. */
+	uip_slen = 0;
+      }
+#endif /* UIP_TCP_PERSIST */
+#if UIP_PACING
+      if(uip_slen > 0 && uip_connr->len > 0 &&
+	 uip_connr->pacer.rate != 0) {
+	if(pace_refill(&uip_connr->pacer)) {
+	  pace_take(&uip_connr->pacer, uip_connr->len);
+	} else {
+	  /* The connection is over its rate, so the data is held
+	     back until the bucket has refilled. */
+	  uip_connr->pacer.held = 1;
+#if UIP_READY_LIST
+	  uip_conn_ready(uip_connr);
+#endif /* UIP_READY_LIST */
+	  uip_slen = 0;
+	}
+      }
+#endif /* UIP_PACING */
       
       /* If the application has data to be sent, or if the incoming
          packet had new data in it, we must send out a packet. */
@@ -1713,6 +5187,43 @@ uip_process(u8_t flag)
 	uip_len = uip_connr->len + UIP_TCPIP_HLEN;
 	/* We always set the ACK flag in response packets. */
 	BUF->flags = TCP_ACK | TCP_PSH;
+#if UIP_TCP_ECN
+	if((uip_connr->ecn & ECN_OK) && !(uip_flags & UIP_REXMIT)) {
+	  /* New data is ECN-capable, but retransmissions are not
+	     (RFC 3168, section 6.1.5). */
+	  ecn_ect = 1;
+	  if(uip_connr->ecn & ECN_CWR) {
+	    BUF->flags |= TCP_CWR;
+	    uip_connr->ecn &= ~ECN_CWR;
+	  }
+	}
+#endif /* UIP_TCP_ECN */
+#if UIP_PMTUD || UIP_RUNTIME_MTU
+	if(lso_data == NULL &&
+	   uip_connr->len > uip_connr->initialmss) {
+	  /* The MSS has been lowered since the data was first sent, so
+	     it is sent again like a large send from uip_buf. The data
+	     after the first segment is not overwritten while the
+	     segments are made, since each segment is put in front of
+	     it. */
+	  lso_data = uip_appdata;
+	}
+#endif /* UIP_PMTUD || UIP_RUNTIME_MTU */
+#if TCP_SPLIT
+	if(lso_data != NULL) {
+	  /* Only the first segment of a large send is built here. The
+	     rest are made from it when it has been sent. */
+	  lso_left = uip_connr->len;
+	  tmp16 = lso_left > uip_connr->initialmss?
+	    uip_connr->initialmss: lso_left;
+	  if(lso_data != uip_appdata) {
+	    memcpy(uip_appdata, lso_data, tmp16);
+	  }
+	  lso_data += tmp16;
+	  lso_left -= tmp16;
+	  uip_len = tmp16 + UIP_TCPIP_HLEN;
+	}
+#endif /* TCP_SPLIT */
 	/* Send the packet. */
 	goto tcp_send_noopts;
       }
@@ -1723,13 +5234,22 @@ uip_process(u8_t flag)
 	BUF->flags = TCP_ACK;
 	goto tcp_send_noopts;
       }
+#if UIP_TCP_RXBUF
+      /* If the application has read enough from the receive ring, we
+	 tell the remote host that the window has opened. */
+      if(rxbuf_wndupdate(uip_connr)) {
+	uip_len = UIP_TCPIP_HLEN;
+	BUF->flags = TCP_ACK;
+	goto tcp_send_noopts;
+      }
+#endif /* UIP_TCP_RXBUF */
     }
     goto drop;
   case UIP_LAST_ACK:
     /* We can close this connection if the peer has acknowledged our
        FIN. This is indicated by the UIP_ACKDATA flag. */
     if(uip_flags & UIP_ACKDATA) {
-      uip_connr->tcpstateflags = UIP_CLOSED;
+      conn_free(uip_connr);
       uip_flags = UIP_CLOSE;
       UIP_APPCALL();
     }
@@ -1816,12 +5336,29 @@ uip_process(u8_t flag)
   BUF->seqno[2] = uip_connr->snd_nxt[2];
   BUF->seqno[3] = uip_connr->snd_nxt[3];
 
+#if UIP_TCP_KEEPALIVE || UIP_TCP_PERSIST
+  if(probe) {
+    /* A keepalive or window probe carries a sequence number that the
+       remote host already has acknowledged, which forces it to
+       answer with an ACK. */
+    probe = 0;
+    c = 4;
+    while(c > 0 && BUF->seqno[--c]-- == 0);
+  }
+#endif /* UIP_TCP_KEEPALIVE || UIP_TCP_PERSIST */
+
+#if UIP_TCP_ECN
+  if((uip_connr->ecn & ECN_ECE) && !(BUF->flags & (TCP_SYN | TCP_RST))) {
+    BUF->flags |= TCP_ECE;
+  }
+#endif /* UIP_TCP_ECN */
+
   BUF->proto = UIP_PROTO_TCP;
   
   BUF->srcport  = uip_connr->lport;
   BUF->destport = uip_connr->rport;
 
-  uip_ipaddr_copy(BUF->srcipaddr, uip_hostaddr);
+  uip_ipaddr_copy(BUF->srcipaddr, UIP_SRCADDR(uip_connr->ripaddr));
   uip_ipaddr_copy(BUF->destipaddr, uip_connr->ripaddr);
 
   if(uip_connr->tcpstateflags & UIP_STOPPED) {
@@ -1831,6 +5368,14 @@ uip_process(u8_t flag)
   } else {
     BUF->wnd[0] = ((UIP_RECEIVE_WINDOW) >> 8);
     BUF->wnd[1] = ((UIP_RECEIVE_WINDOW) & 0xff);
+#if UIP_TCP_RXBUF
+    if(uip_connr->rxbuf != NULL) {
+      /* The window is the free space in the receive ring. */
+      uip_connr->rxwnd = uip_connr->rxsize - uip_connr->rxlen;
+      BUF->wnd[0] = uip_connr->rxwnd >> 8;
+      BUF->wnd[1] = uip_connr->rxwnd & 0xff;
+    }
+#endif /* UIP_TCP_RXBUF */
   }
 
  tcp_send_noconn:
@@ -1857,10 +5402,27 @@ uip_process(u8_t flag)
   BUF->vtc = 0x60;
   BUF->tcflow = 0x00;
   BUF->flow = 0x00;
+#if UIP_TCP_ECN
+  if(ecn_ect) {
+    BUF->tcflow = IP_ECN_ECT0 << 4;
+    ecn_ect = 0;
+  }
+#endif /* UIP_TCP_ECN */
 #else /* UIP_CONF_IPV6 */
   BUF->vhl = 0x45;
   BUF->tos = 0;
+#if UIP_TCP_ECN
+  if(ecn_ect) {
+    BUF->tos = IP_ECN_ECT0;
+    ecn_ect = 0;
+  }
+#endif /* UIP_TCP_ECN */
   BUF->ipoffset[0] = BUF->ipoffset[1] = 0;
+#if UIP_PMTUD
+  if(BUF->proto == UIP_PROTO_TCP) {
+    BUF->ipoffset[0] = IP_DF;
+  }
+#endif /* UIP_PMTUD */
   ++ipid;
   BUF->ipid[0] = ipid >> 8;
   BUF->ipid[1] = ipid & 0xff;
@@ -1876,10 +5438,31 @@ uip_process(u8_t flag)
 	       (BUF->len[0] << 8) | BUF->len[1]);
   
   UIP_STAT(++uip_stat.ip.sent);
+#if TCP_SPLIT
+  if(lso_left > 0) {
+    lso_output(uip_connr->initialmss);
+  }
+#endif /* TCP_SPLIT */
+#if UIP_DUAL_STACK
+  ip4_output();
+  if(uip_len == 0) {
+    goto drop;
+  }
+#endif /* UIP_DUAL_STACK */
+#if UIP_TCP_TIMER_WHEEL
+  if(timed_conn != NULL) {
+    wheel_update(timed_conn);
+  }
+#endif /* UIP_TCP_TIMER_WHEEL */
   /* Return and let the caller do the actual transmission. */
   uip_flags = 0;
   return;
  drop:
+#if UIP_TCP_TIMER_WHEEL
+  if(timed_conn != NULL) {
+    wheel_update(timed_conn);
+  }
+#endif /* UIP_TCP_TIMER_WHEEL */
   uip_len = 0;
   uip_flags = 0;
   return;
@@ -1901,4 +5484,322 @@ uip_send(const void *data, int len)
     }
   }
 }
+#if UIP_LSO
+/*---------------------------------------------------------------------------*/
+void
+uip_send_large(const void *data, u16_t len)
+{
+  if((uip_conn->tcpstateflags & UIP_TS_MASK) != UIP_ESTABLISHED) {
+    /* Data sent during the handshake goes in the SYN or SYNACK. */
+    uip_send(data, len > uip_mss()? uip_mss(): len);
+  } else if(len > 0) {
+    uip_slen = len;
+    lso_data = data;
+  }
+}
+#endif /* UIP_LSO */
+#if UIP_TCP_RXBUF
+/*---------------------------------------------------------------------------*/
+void
+uip_rxbuf(struct uip_conn *conn, u8_t *buf, u16_t size)
+{
+  conn->rxbuf = buf;
+  conn->rxsize = size;
+  conn->rxstart = conn->rxlen = 0;
+  conn->rxwnd = UIP_RECEIVE_WINDOW;
+}
+/*---------------------------------------------------------------------------*/
+u16_t
+uip_conn_read(struct uip_conn *conn, void *buf, u16_t len)
+{
+  u16_t n;
+
+  if(conn->rxbuf == NULL) {
+    return 0;
+  }
+  if(len > conn->rxlen) {
+    len = conn->rxlen;
+  }
+  n = conn->rxsize - conn->rxstart;
+  if(n > len) {
+    n = len;
+  }
+  memcpy(buf, &conn->rxbuf[conn->rxstart], n);
+  memcpy((u8_t *)buf + n, conn->rxbuf, len - n);
+  conn->rxstart += len;
+  if(conn->rxstart >= conn->rxsize) {
+    conn->rxstart -= conn->rxsize;
+  }
+  conn->rxlen -= len;
+#if UIP_READY_LIST
+  /* The window update is sent when the connection is polled. */
+  if((conn->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+     rxbuf_wndupdate(conn)) {
+    uip_conn_ready(conn);
+  }
+#endif /* UIP_READY_LIST */
+  return len;
+}
+#endif /* UIP_TCP_RXBUF */
+#if UIP_TCP_TXBUF
+/*---------------------------------------------------------------------------*/
+void
+uip_txbuf(struct uip_conn *conn, u8_t *buf, u16_t size)
+{
+  conn->txbuf = buf;
+  conn->txsize = size;
+  conn->txstart = conn->txlen = 0;
+}
+/*---------------------------------------------------------------------------*/
+u16_t
+uip_write(struct uip_conn *conn, const void *data, u16_t len)
+{
+  u16_t end, n;
+
+  if(conn->txbuf == NULL || conn->txclose) {
+    return 0;
+  }
+  if(len > conn->txsize - conn->txlen) {
+    len = conn->txsize - conn->txlen;
+  }
+  end = conn->txstart + conn->txlen;
+  if(end >= conn->txsize) {
+    end -= conn->txsize;
+  }
+  n = conn->txsize - end;
+  if(n > len) {
+    n = len;
+  }
+  memcpy(&conn->txbuf[end], data, n);
+  memcpy(conn->txbuf, (const u8_t *)data + n, len - n);
+  conn->txlen += len;
+#if UIP_READY_LIST
+  if(len > 0) {
+    uip_conn_ready(conn);
+  }
+#elif UIP_TCP_TIMER_WHEEL
+  /* Make sure that the connection is processed on the next tick if
+     no timer is going to bring it up earlier. */
+  if(len > 0 && (conn->twkind == TW_NONE || conn->twkind == TW_KA)) {
+    wheel_sync(conn, 0);
+    wheel_update(conn);
+  }
+#endif /* UIP_READY_LIST */
+  return len;
+}
+#endif /* UIP_TCP_TXBUF */
+#if UIP_PACING
+/*---------------------------------------------------------------------------*/
+void
+uip_pace(struct uip_conn *conn, u16_t rate, u16_t burst)
+{
+  pace_init(&conn->pacer, rate, burst);
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP
+void
+uip_udp_pace(struct uip_udp_conn *conn, u16_t rate, u16_t burst)
+{
+  pace_init(&conn->pacer, rate, burst);
+}
+#endif /* UIP_UDP */
+#endif /* UIP_PACING */
+#if UIP_INPUT_BATCH
+#if !UIP_CONF_IPV6
+/*---------------------------------------------------------------------------*/
+#define FRAMEBUF(f) ((struct uip_tcpip_hdr *)&(f)->buf[UIP_LLH_LEN])
+
+/* The number of frames that are looked at for segments to merge with
+   the one being processed. */
+#define BATCH_WINDOW 32
+
+/* State of the frames in the window, with one bit per frame and the
+   frame being processed in the lowest bit. */
+static unsigned long batch_merged;  /* Merged into an earlier segment. */
+static unsigned long batch_checked; /* Looked at by batch_ok(). */
+static unsigned long batch_good;    /* Can be merged. */
+
+/* Check if a frame holds a TCP segment that can be merged with its
+   neighbours: an unfragmented segment without options that carries
+   nothing but data, ACK and PSH, and has correct checksums. */
+static u8_t
+batch_mergeable(struct uip_frame *f)
+{
+  struct uip_tcpip_hdr *hdr;
+  u16_t len, sum, t;
+
+  if(f->len < UIP_LLH_LEN + UIP_IPTCPH_LEN) {
+    return 0;
+  }
+  hdr = FRAMEBUF(f);
+  len = (hdr->len[0] << 8) + hdr->len[1];
+  if(hdr->vhl != 0x45 || hdr->proto != UIP_PROTO_TCP ||
+     (hdr->ipoffset[0] & 0x3f) != 0 || hdr->ipoffset[1] != 0 ||
+     len < UIP_IPTCPH_LEN || len > f->len - UIP_LLH_LEN ||
+     hdr->tcpoffset != (UIP_TCPH_LEN / 4) << 4 ||
+     (hdr->flags & (TCP_CTL & ~TCP_PSH)) != TCP_ACK) {
+    return 0;
+  }
+  if(uip_chksum((u16_t *)hdr, UIP_IPH_LEN) != 0xffff) {
+    return 0;
+  }
+  /* The TCP checksum covers a pseudo header with the addresses,
+     protocol and length. The sums are all in network byte order. */
+  len -= UIP_IPH_LEN;
+  sum = htons(len + UIP_PROTO_TCP);
+  t = uip_chksum((u16_t *)hdr->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum += t;
+  if(sum < t) {
+    sum++;		/* carry */
+  }
+  t = uip_chksum((u16_t *)&hdr->srcport, len);
+  sum += t;
+  if(sum < t) {
+    sum++;		/* carry */
+  }
+  return sum == 0xffff;
+}
+/*---------------------------------------------------------------------------*/
+/* batch_mergeable() for frame k of the window that starts at f, which
+   checks every frame only once. */
+static u8_t
+batch_ok(struct uip_frame *f, u16_t k)
+{
+  unsigned long bit;
+
+  bit = 1UL << k;
+  if(!(batch_checked & bit)) {
+    batch_checked |= bit;
+    if(batch_mergeable(&f[k])) {
+      batch_good |= bit;
+    }
+  }
+  return (batch_good & bit) != 0;
+}
+#endif /* !UIP_CONF_IPV6 */
+/*---------------------------------------------------------------------------*/
+void
+uip_input_batch(struct uip_frame *frames, u16_t n)
+{
+  u16_t i;
+#if !UIP_CONF_IPV6
+  struct uip_tcpip_hdr *hdr;
+  u16_t k, len, dlen;
+  u8_t merged;
+
+  batch_merged = batch_checked = batch_good = 0;
+#endif /* !UIP_CONF_IPV6 */
+
+  for(i = 0; i < n; ++i) {
+#if !UIP_CONF_IPV6
+    if(i > 0) {
+      batch_merged >>= 1;
+      batch_checked >>= 1;
+      batch_good >>= 1;
+    }
+    if(batch_merged & 1) {
+      continue;
+    }
+#endif /* !UIP_CONF_IPV6 */
+    if(frames[i].len > UIP_BUFSIZE) {
+      UIP_STAT(++uip_stat.ip.drop);
+      continue;
+    }
+    memcpy(uip_buf, frames[i].buf, frames[i].len);
+    uip_len = frames[i].len;
+
+#if !UIP_CONF_IPV6
+    if(batch_ok(&frames[i], 0)) {
+      batch_verified = 1;
+      len = (BUF->len[0] << 8) + BUF->len[1];
+      merged = 0;
+
+      /* Append the data of the segments that follow in sequence on
+	 the same connection, and take the ACK, window and PSH flag
+	 from the last one. Segments of other connections are left
+	 for later, so the connections of a batch may be interleaved,
+	 but nothing else from the same host is overtaken. */
+      for(k = 1; k < BATCH_WINDOW && k < n - i; ++k) {
+	if(batch_merged & (1UL << k)) {
+	  continue;
+	}
+	hdr = FRAMEBUF(&frames[i + k]);
+	if(frames[i + k].len < UIP_LLH_LEN + UIP_IPH_LEN ||
+	   !uip_ipaddr_cmp(hdr->srcipaddr, BUF->srcipaddr) ||
+	   !uip_ipaddr_cmp(hdr->destipaddr, BUF->destipaddr)) {
+	  continue;
+	}
+	if(!batch_ok(&frames[i], k)) {
+	  break;
+	}
+	if(hdr->srcport != BUF->srcport ||
+	   hdr->destport != BUF->destport) {
+	  continue;
+	}
+	uip_add32(BUF->seqno, len - UIP_IPTCPH_LEN);
+	dlen = ((hdr->len[0] << 8) + hdr->len[1]) - UIP_IPTCPH_LEN;
+	if(hdr->tos != BUF->tos ||
+	   memcmp(hdr->seqno, uip_acc32, 4) != 0 ||
+	   UIP_LLH_LEN + len + dlen > UIP_BUFSIZE) {
+	  break;
+	}
+	memcpy(&uip_buf[UIP_LLH_LEN + len],
+	       (u8_t *)hdr + UIP_IPTCPH_LEN, dlen);
+	len += dlen;
+	memcpy(BUF->ackno, hdr->ackno, 4);
+	BUF->wnd[0] = hdr->wnd[0];
+	BUF->wnd[1] = hdr->wnd[1];
+	BUF->flags |= hdr->flags;
+	batch_merged |= 1UL << k;
+	merged = 1;
+      }
+
+      if(merged) {
+	uip_len = UIP_LLH_LEN + len;
+	BUF->len[0] = (len >> 8);
+	BUF->len[1] = (len & 0xff);
+	BUF->ipchksum = 0;
+	BUF->ipchksum = ~(uip_ipchksum());
+      }
+    }
+#endif /* !UIP_CONF_IPV6 */
+
+    uip_input();
+    batch_verified = 0;
+    if(uip_len > 0) {
+      UIP_BATCH_OUTPUT();
+    }
+  }
+  uip_len = 0;
+#if UIP_TX_BATCH
+  uip_tx_flush();
+#endif /* UIP_TX_BATCH */
+}
+#endif /* UIP_INPUT_BATCH */
+#if UIP_TX_BATCH
+/*---------------------------------------------------------------------------*/
+void
+uip_tx_queue(void)
+{
+  if(uip_len == 0 || uip_len > UIP_BUFSIZE) {
+    return;
+  }
+  if(tx_count == UIP_TX_BATCH_SIZE) {
+    uip_tx_flush();
+  }
+  memcpy(tx_bufs[tx_count], uip_buf, uip_len);
+  tx_frames[tx_count].buf = tx_bufs[tx_count];
+  tx_frames[tx_count].len = uip_len;
+  ++tx_count;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_tx_flush(void)
+{
+  if(tx_count > 0) {
+    UIP_TX_BATCH_OUTPUT(tx_frames, tx_count);
+    tx_count = 0;
+  }
+}
+#endif /* UIP_TX_BATCH */
 /** @} */
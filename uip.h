@@ -53,6 +53,9 @@
 #define __UIP_H__
 
 #include "uipopt.h"
+#if UIP_PACING
+#include "clock.h"
+#endif /* UIP_PACING */
 
 /**
  * Repressentation of an IP address.  ʾһIPַ
@@ -171,6 +174,89 @@ typedef uip_ip4addr_t uip_ipaddr_t;
  */
 #define uip_getnetmask(addr) uip_ipaddr_copy((addr), uip_netmask)
 
+#if UIP_RUNTIME_MTU
+/**
+ * Set the MTU of the network interface.
+ *
+ * The MTU is limited to what fits in the uip_buf buffer. The TCP MSS
+ * of new connections follows the MTU; open connections are lowered
+ * to it if it shrinks, but are not raised if it grows. Data that is
+ * in transit when the MTU shrinks is retransmitted in several
+ * segments, so the application still gets UIP_ACKDATA for all of it.
+ *
+ * \note This function is only available if UIP_RUNTIME_MTU is set.
+ *
+ * \param mtu The largest IP packet that the interface can send.
+ */
+void uip_setmtu(u16_t mtu);
+#endif /* UIP_RUNTIME_MTU */
+
+/**
+ * Get the MTU of the network interface.
+ *
+ * \hideinitializer
+ */
+#define uip_getmtu() (UIP_MTU)
+
+#if UIP_DUAL_STACK
+/**
+ * Set the IPv4 address of this host in a dual-stack build.
+ *
+ * \param addr A pointer to an IPv4-mapped address, constructed with
+ * uip_ip4addr().
+ *
+ * \hideinitializer
+ */
+#define uip_sethostaddr4(addr) uip_ipaddr_copy(uip_hostaddr4, (addr))
+
+/**
+ * Get the IPv4 address of this host in a dual-stack build.
+ *
+ * \param addr A pointer to a uip_ipaddr_t variable that will be
+ * filled in with the IPv4-mapped address of the host.
+ *
+ * \hideinitializer
+ */
+#define uip_gethostaddr4(addr) uip_ipaddr_copy((addr), uip_hostaddr4)
+
+/**
+ * Set the IPv4 default router in a dual-stack build.
+ *
+ * The default router and the netmask are only used by the ARP module
+ * to find the link level address of IPv4 peers.
+ *
+ * \param addr A pointer to an IPv4-mapped address, constructed with
+ * uip_ip4addr().
+ *
+ * \hideinitializer
+ */
+#define uip_setdraddr4(addr) uip_ipaddr_copy(uip_draddr4, (addr))
+
+/**
+ * Set the IPv4 netmask in a dual-stack build.
+ *
+ * \param addr A pointer to an IPv4-mapped address, constructed with
+ * uip_ip4addr().
+ *
+ * \hideinitializer
+ */
+#define uip_setnetmask4(addr) uip_ipaddr_copy(uip_netmask4, (addr))
+
+/**
+ * Get the IPv4 default router in a dual-stack build.
+ *
+ * \hideinitializer
+ */
+#define uip_getdraddr4(addr) uip_ipaddr_copy((addr), uip_draddr4)
+
+/**
+ * Get the IPv4 netmask in a dual-stack build.
+ *
+ * \hideinitializer
+ */
+#define uip_getnetmask4(addr) uip_ipaddr_copy((addr), uip_netmask4)
+#endif /* UIP_DUAL_STACK */
+
 /** @} */
 
 /**
@@ -268,6 +354,90 @@ void uip_setipid(u16_t id);
  */
 #define uip_input()        uip_process(UIP_DATA)
 
+#if UIP_INPUT_BATCH || UIP_TX_BATCH
+/**
+ * A frame passed between uIP and the network device in a batch.
+ *
+ * The frame is laid out in the same way as the uIP packet buffer,
+ * with UIP_LLH_LEN bytes of link level header in front of the IP
+ * packet, and should be aligned in the same way as uip_buf.
+ */
+struct uip_frame {
+  u8_t *buf;    /**< The frame, including the link level header. */
+  u16_t len;    /**< The length of the frame. */
+};
+#endif /* UIP_INPUT_BATCH || UIP_TX_BATCH */
+
+#if UIP_INPUT_BATCH
+/**
+ * Process a batch of incoming frames.
+ *
+ * This function is used instead of uip_input() by device drivers
+ * that receive several frames at a time. The frames are processed in
+ * order, but in-order TCP segments of the same connection are merged
+ * so that the application sees their data in one uip_newdata() event
+ * and only one ACK is sent for them. The merged segments are
+ * processed where the first of them was, ahead of the segments of
+ * other connections that came between them. Segments with flags
+ * other than ACK and PSH, or with TCP options, are never merged, and
+ * nothing from the same host is moved ahead of them.
+ *
+ * Every packet that uIP sends in response to the frames is sent with
+ * UIP_BATCH_OUTPUT(). The frames are copied into uip_buf and may be
+ * reused as soon as the function returns, at which point uip_len is
+ * zero.
+ *
+ * \note The configuration parameter UIP_INPUT_BATCH must be set for
+ * this function to be enabled.
+ *
+ * \param frames The received frames.
+ *
+ * \param n The number of frames.
+ */
+void uip_input_batch(struct uip_frame *frames, u16_t n);
+#endif /* UIP_INPUT_BATCH */
+
+#if UIP_TX_BATCH
+/**
+ * Queue the packet in uip_buf for batched transmission.
+ *
+ * This function is used instead of calling the device driver
+ * directly when uip_len is larger than zero after a call to uIP. The
+ * packet is copied out of uip_buf, which may then be reused. The
+ * queued packets are handed to the driver in one call to
+ * UIP_TX_BATCH_OUTPUT() when uip_tx_flush() is called, or when the
+ * queue is full. The link level header must be filled in, and
+ * counted in uip_len, before the packet is queued (as is done by
+ * uip_arp_out()).
+ *
+ * A periodic pass would typically look like this:
+ \code
+  for(i = 0; i < UIP_CONNS; ++i) {
+    uip_periodic(i);
+    if(uip_len > 0) {
+      uip_arp_out();
+      uip_tx_queue();
+    }
+  }
+  uip_tx_flush();
+ \endcode
+ *
+ * \note The configuration parameter UIP_TX_BATCH must be set for this
+ * function to be enabled.
+ */
+void uip_tx_queue(void);
+
+/**
+ * Hand all queued packets to the device driver.
+ *
+ * The packets are passed to UIP_TX_BATCH_OUTPUT() as a vector of
+ * frames in the order they were queued. uip_input_batch() calls this
+ * function before it returns, so the packets sent in response to a
+ * batch of input leave in one batch if UIP_BATCH_OUTPUT queues them.
+ */
+void uip_tx_flush(void);
+#endif /* UIP_TX_BATCH */
+
 /**
  * Periodic processing for a connection identified by its number.
  	ڴȷ
@@ -361,6 +531,316 @@ void uip_setipid(u16_t id);
 #define uip_poll_conn(conn) do { uip_conn = conn; \
                                  uip_process(UIP_POLL_REQUEST); } while (0)
 
+#if UIP_TCP_TIMER_WHEEL
+/**
+ * Advance the TCP timer wheel by one tick.
+ *
+ * When uIP is configured with UIP_CONF_TCP_TIMER_WHEEL, this function
+ * should be called when the periodic uIP timer goes off, instead of
+ * calling uip_periodic() for every connection. The connections whose
+ * timers expired on this tick are then fetched with
+ * uip_wheel_expired() and processed with uip_periodic_conn():
+ \code
+  struct uip_conn *conn;
+
+  uip_wheel_tick();
+  while((conn = uip_wheel_expired()) != NULL) {
+    uip_periodic_conn(conn);
+    if(uip_len > 0) {
+      uip_arp_out();
+      ethernet_devicedriver_send();
+    }
+  }
+ \endcode
+ */
+void uip_wheel_tick(void);
+
+/**
+ * Get the next connection whose timer has expired.
+ *
+ * \return A pointer to a connection that must be processed with
+ * uip_periodic_conn(), or NULL if no more timers have expired.
+ */
+struct uip_conn *uip_wheel_expired(void);
+#endif /* UIP_TCP_TIMER_WHEEL */
+
+#if UIP_TCP_KEEPALIVE
+struct uip_conn;
+/**
+ * Set the keepalive parameters of a connection.
+ *
+ * New connections get the parameters from UIP_TCP_KEEPALIVE_IDLE,
+ * UIP_TCP_KEEPALIVE_INTVL and UIP_TCP_KEEPALIVE_CNT. This function is
+ * typically called from the application when the UIP_CONNECTED flag
+ * is set.
+ *
+ * \param conn A pointer to the uip_conn struct for the connection.
+ *
+ * \param idle The number of timer ticks without any segment from the
+ * remote host before the first probe is sent, or zero to turn
+ * keepalive off.
+ *
+ * \param intvl The number of timer ticks between probes.
+ *
+ * \param cnt The number of unanswered probes after which the
+ * connection is reset and the application is called with the
+ * UIP_TIMEDOUT flag.
+ */
+void uip_keepalive(struct uip_conn *conn, u16_t idle, u16_t intvl, u8_t cnt);
+#endif /* UIP_TCP_KEEPALIVE */
+
+#if UIP_TCP_FASTOPEN
+/**
+ * Set the key for the TCP Fast Open cookies.
+ *
+ * The cookies that are handed out to clients are computed from the
+ * client's IP address with this key, so the key should be random and
+ * kept secret. Changing the key invalidates all cookies that have
+ * been handed out. A listener does not hand out or accept cookies
+ * before this function has been called.
+ *
+ * \param key A pointer to the eight bytes of the key.
+ */
+void uip_fastopen_key(const u8_t *key);
+#endif /* UIP_TCP_FASTOPEN */
+
+#if UIP_PACING
+struct uip_conn;
+struct uip_udp_conn;
+/**
+ * Limit the transmit rate of a TCP connection.
+ *
+ * Data that the application sends while the connection is over its
+ * rate is held back, and the application is asked to retransmit it
+ * (with the uip_rexmit() event) when the connection is polled after
+ * the bucket has refilled. With UIP_READY_LIST the connection is put
+ * on the ready list while data is held back; otherwise it is
+ * released by the periodic timer or uip_poll_conn().
+ *
+ * \param conn A pointer to the connection.
+ *
+ * \param rate The rate in bytes per clock tick (CLOCK_SECOND ticks a
+ * second), or zero to stop pacing the connection.
+ *
+ * \param burst The number of bytes that may be sent back to back,
+ * at most 32767.
+ */
+void uip_pace(struct uip_conn *conn, u16_t rate, u16_t burst);
+
+/**
+ * Limit the transmit rate of a UDP connection.
+ *
+ * The connection is not polled while it is over its rate. Datagrams
+ * that are sent in response to incoming datagrams are always sent,
+ * but count against the rate.
+ *
+ * \param conn A pointer to the connection.
+ *
+ * \param rate The rate in bytes per clock tick, or zero to stop
+ * pacing the connection.
+ *
+ * \param burst The size of the bucket, at most 32767.
+ */
+void uip_udp_pace(struct uip_udp_conn *conn, u16_t rate, u16_t burst);
+#endif /* UIP_PACING */
+
+#if UIP_TCP_RXBUF
+struct uip_conn;
+/**
+ * Give a TCP connection a receive buffer.
+ *
+ * From now on, data that arrives on the connection is stored in the
+ * buffer, which is used as a ring, and the window that is advertised
+ * to the remote host is the free space in it. The application is
+ * still invoked with the uip_newdata() event, with uip_datalen()
+ * telling how much data was added to the ring, but it may read the
+ * data later with uip_read(). Data that arrives before the buffer is
+ * given to the connection, e.g. together with the ACK that completes
+ * the handshake, is only available in uip_appdata.
+ *
+ * The buffer is usually given in the uip_connected() event. The
+ * connection keeps it until the connection is reused, so data that
+ * is left in it when the connection closes can still be read in the
+ * uip_closed() or uip_aborted() event.
+ *
+ * \param conn A pointer to the connection.
+ *
+ * \param buf A pointer to the buffer, or NULL to remove the buffer.
+ *
+ * \param size The size of the buffer.
+ */
+void uip_rxbuf(struct uip_conn *conn, u8_t *buf, u16_t size);
+
+/**
+ * Read data from the receive buffer of a TCP connection.
+ *
+ * The function may be called at any time, not just from the
+ * application callback. If reading opens the window of the
+ * connection far enough, the connection will send a window update
+ * the next time it is polled.
+ *
+ * \param conn A pointer to the connection.
+ *
+ * \param buf A pointer to where the data should be copied.
+ *
+ * \param len The maximum number of bytes to read.
+ *
+ * \return The number of bytes that were read.
+ */
+u16_t uip_conn_read(struct uip_conn *conn, void *buf, u16_t len);
+
+/**
+ * Read data from the receive buffer of the current connection.
+ *
+ * \sa uip_conn_read()
+ *
+ * \hideinitializer
+ */
+#define uip_read(buf, len) uip_conn_read(uip_conn, buf, len)
+
+/**
+ * The number of bytes waiting in the receive buffer of a connection.
+ *
+ * \hideinitializer
+ */
+#define uip_rxavail(conn) ((conn)->rxlen)
+#endif /* UIP_TCP_RXBUF */
+
+#if UIP_TCP_TXBUF
+struct uip_conn;
+/**
+ * Give a TCP connection a send buffer.
+ *
+ * Data that is written to the connection with uip_write() is queued
+ * in the buffer, which is used as a ring, until it has been
+ * acknowledged by the remote host. uIP takes care of sending and
+ * retransmitting the data, so the application should not use
+ * uip_send() on a connection that has a send buffer.
+ *
+ * If the application closes the connection while data is queued,
+ * the connection is closed when all of it has been sent.
+ *
+ * \param conn A pointer to the connection.
+ *
+ * \param buf A pointer to the buffer, or NULL to remove the buffer.
+ *
+ * \param size The size of the buffer.
+ */
+void uip_txbuf(struct uip_conn *conn, u8_t *buf, u16_t size);
+
+/**
+ * Queue data for sending on a TCP connection.
+ *
+ * The function may be called at any time, not just from the
+ * application callback. The data is sent the next time the
+ * connection is polled: with UIP_READY_LIST the connection is put on
+ * the ready list, with UIP_TCP_TIMER_WHEEL it is scheduled to expire
+ * on the next tick of the wheel, and otherwise it is sent at the
+ * next periodic timer. The connection can also be polled right away
+ * with uip_poll_conn() from outside of uIP.
+ *
+ * \param conn A pointer to the connection.
+ *
+ * \param data A pointer to the data.
+ *
+ * \param len The number of bytes to queue.
+ *
+ * \return The number of bytes that fit in the send buffer.
+ */
+u16_t uip_write(struct uip_conn *conn, const void *data, u16_t len);
+
+/**
+ * The free space in the send buffer of a connection.
+ *
+ * \hideinitializer
+ */
+#define uip_txfree(conn) ((conn)->txsize - (conn)->txlen)
+
+/**
+ * Has all data in the send buffer of the current connection been
+ * acknowledged?
+ *
+ * This is true in the uip_acked() event that empties the send
+ * buffer, so applications do not have to keep track of how much of
+ * their data has been acknowledged.
+ *
+ * \hideinitializer
+ */
+#define uip_drained() (uip_acked() && uip_conn->txlen == 0)
+#endif /* UIP_TCP_TXBUF */
+
+#if UIP_PMTUD
+/**
+ * Set the MTU of a route.
+ *
+ * TCP connections to hosts on the route will not use segments that
+ * are larger than the MTU allows, and advertise a matching MSS to
+ * the remote host. This is useful for tunnels and other links with a
+ * small MTU that is known beforehand. Routes are not aged out.
+ *
+ * \param addr A pointer to the network address of the route.
+ *
+ * \param netmask A pointer to the netmask of the route.
+ *
+ * \param mtu The MTU of the route, or zero to remove the route.
+ */
+void uip_pmtu_route(uip_ipaddr_t *addr, uip_ipaddr_t *netmask, u16_t mtu);
+
+/**
+ * Age the learned path MTUs.
+ *
+ * This function should be called every ten seconds.
+ */
+void uip_pmtu_timer(void);
+#endif /* UIP_PMTUD */
+
+#if UIP_READY_LIST
+struct uip_conn;
+/**
+ * Mark a connection as having data to send.
+ *
+ * When uIP is configured with UIP_CONF_READY_LIST, the periodic timer
+ * does not poll the application. Instead, the application calls this
+ * function when it has new data for a connection, and the connection
+ * is polled the next time the ready list is serviced. The mark is
+ * cleared when the connection is polled, so an application that still
+ * has data to send after being polled should mark the connection
+ * again. A connection that is not established yet or still has data
+ * in transit is not polled, and keeps its mark until it can be.
+ * Marking a connection that already is marked has no effect.
+ *
+ * \param conn A pointer to the uip_conn struct for the connection.
+ */
+void uip_conn_ready(struct uip_conn *conn);
+
+/**
+ * Get the next connection from the ready list.
+ *
+ * The connections are returned in the order they were marked. A
+ * round returns each connection that was marked when it started at
+ * most once, and no more than UIP_READY_BUDGET connections, before
+ * the function returns NULL. A new round starts after NULL has been
+ * returned or the periodic timer has ticked. This function typically
+ * is called when the periodic uIP timer goes off:
+ \code
+  struct uip_conn *conn;
+
+  while((conn = uip_ready_next()) != NULL) {
+    uip_poll_conn(conn);
+    if(uip_len > 0) {
+      uip_arp_out();
+      ethernet_devicedriver_send();
+    }
+  }
+ \endcode
+ *
+ * \return A pointer to a connection that should be polled with
+ * uip_poll_conn(), or NULL if the list is empty or the budget for this
+ * round is used up.
+ */
+struct uip_conn *uip_ready_next(void);
+#endif /* UIP_READY_LIST */
+
 
 #if UIP_UDP
 /**
@@ -423,6 +903,57 @@ void uip_setipid(u16_t id);
 
 #endif /* UIP_UDP */
 
+#if UIP_IGMP
+/**
+ * Periodic processing for multicast group membership.
+ *
+ * This function sends the IGMP reports that are due, and should be
+ * called every UIP_IGMP_TICK tenths of a second. When the function
+ * returns, the report to send, if any, is in the uip_buf packet
+ * buffer, with its length in uip_len.
+ *
+ * Usage:
+ \code
+ uip_igmp_periodic();
+ if(uip_len > 0) {
+   uip_arp_out();
+   ethernet_devicedriver_send();
+ }
+ \endcode
+ *
+ * \note The configuration parameter UIP_IGMP must be set for this
+ * function to be enabled.
+ *
+ * \hideinitializer
+ */
+#define uip_igmp_periodic() uip_process(UIP_IGMP_TIMER)
+
+/**
+ * Join a multicast group.
+ *
+ * Packets sent to the group are accepted from now on, and multicast
+ * routers are told about the membership with the next calls to
+ * uip_igmp_periodic(). A group may be joined several times, and is
+ * left when it has been left as many times.
+ *
+ * \note The configuration parameter UIP_IGMP must be set for this
+ * function to be enabled.
+ *
+ * \param group The multicast group.
+ *
+ * \return Non-zero if the group was joined, zero if UIP_IGMP_GROUPS
+ * groups are joined already.
+ */
+u8_t uip_igmp_join(uip_ipaddr_t *group);
+
+/**
+ * Leave a multicast group.
+ *
+ * \param group The multicast group.
+ */
+void uip_igmp_leave(uip_ipaddr_t *group);
+#endif /* UIP_IGMP */
+
 /**
  * The uIP packet buffer.  uipĻ
  *
@@ -589,6 +1120,38 @@ struct uip_conn *uip_connect(uip_ipaddr_t *ripaddr, u16_t port);
  */
 void uip_send(const void *data, int len);
 
+#if UIP_LSO
+/**
+ * Send data that may span several segments on the current connection.
+ *
+ * This function works like uip_send(), but the amount of data that
+ * is sent out is only limited by the receiver's window, not by the
+ * MSS. uIP splits the data into segments and sends them all in a
+ * burst. The data is not copied into uip_buf until it is sent, so it
+ * must stay intact until it has been acknowledged.
+ *
+ * When the data is acknowledged, the number of bytes that were
+ * acknowledged can be read from uip_acklen. If the data is lost, the
+ * application is invoked with the uip_rexmit() event and must call
+ * this function again with the same data.
+ *
+ * \note The configuration parameter UIP_LSO must be set for this
+ * function to be enabled.
+ *
+ * \param data A pointer to the data which is to be sent.
+ *
+ * \param len The maximum amount of data bytes to be sent.
+ */
+void uip_send_large(const void *data, u16_t len);
+
+/**
+ * The amount of data that was acknowledged by the remote host.
+ *
+ * This variable is only valid when uip_acked() is true.
+ */
+extern u16_t uip_acklen;
+#endif /* UIP_LSO */
+
 /**
  * The length of any incoming data that is currently avaliable (if avaliable)
  * in the uip_appdata buffer.
@@ -852,7 +1415,12 @@ struct uip_udp_conn *uip_udp_new(uip_ipaddr_t *ripaddr, u16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_CONN_POOL || UIP_UDP_HASH || UIP_IGMP
+struct uip_udp_conn;
+void uip_udp_remove(struct uip_udp_conn *conn);
+#else /* UIP_CONN_POOL || UIP_UDP_HASH || UIP_IGMP */
 #define uip_udp_remove(conn) (conn)->lport = 0
+#endif /* UIP_CONN_POOL || UIP_UDP_HASH || UIP_IGMP */
 
 /**
  * Bind a UDP connection to a local port.
@@ -866,7 +1434,11 @@ struct uip_udp_conn *uip_udp_new(uip_ipaddr_t *ripaddr, u16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_UDP_HASH
+void uip_udp_bind(struct uip_udp_conn *conn, u16_t port);
+#else /* UIP_UDP_HASH */
 #define uip_udp_bind(conn, port) (conn)->lport = port
+#endif /* UIP_UDP_HASH */
 
 /**
  * Send a UDP datagram of length len on the current connection.
@@ -885,6 +1457,132 @@ struct uip_udp_conn *uip_udp_new(uip_ipaddr_t *ripaddr, u16_t rport);
  */
 #define uip_udp_send(len) uip_send((char *)uip_appdata, len)
 
+#if UIP_UDP_RXQ
+/**
+ * A datagram read from a UDP receive queue with uip_udp_recv().
+ */
+struct uip_udp_msg {
+  void *buf;             /**< Where the data of the datagram is put. */
+  u16_t size;            /**< The size of buf. */
+  u16_t len;             /**< The length of the datagram. If this is
+			    larger than size, the rest of the datagram
+			    was discarded. */
+  uip_ipaddr_t ripaddr;  /**< The IP address of the sender. */
+  u16_t rport;           /**< The port of the sender, in network byte
+			    order. */
+};
+
+/**
+ * Give a UDP connection a receive queue.
+ *
+ * Datagrams that arrive on a connection with a receive queue are put
+ * in the queue instead of being handed to the application, so that
+ * the application can read them later, several at a time, with
+ * uip_udp_recv(). Datagrams that do not fit in the queue are dropped
+ * and counted in uip_stat.udp.qdrop. Each datagram takes up its
+ * length plus a few bytes for its sender in the queue.
+ *
+ * \note The configuration parameter UIP_UDP_RXQ must be set for this
+ * function to be enabled.
+ *
+ * \param conn The UDP connection.
+ *
+ * \param buf The memory for the queue, or NULL to remove the queue.
+ *
+ * \param size The size of buf, at most 32767 bytes.
+ */
+void uip_udp_rxq(struct uip_udp_conn *conn, u8_t *buf, u16_t size);
+
+/**
+ * Read datagrams from the receive queue of a UDP connection.
+ *
+ * Up to n datagrams are read, oldest first, into the messages in
+ * msgs. The buf and size fields of each message must be set by the
+ * caller; the other fields are filled in.
+ *
+ * \param conn The UDP connection.
+ *
+ * \param msgs The messages to read the datagrams into.
+ *
+ * \param n The number of messages.
+ *
+ * \return The number of datagrams that were read.
+ */
+u16_t uip_udp_recv(struct uip_udp_conn *conn, struct uip_udp_msg *msgs,
+		   u16_t n);
+
+/**
+ * The number of datagrams in the receive queue of a UDP connection.
+ *
+ * \hideinitializer
+ */
+#define uip_udp_rxavail(conn) ((conn)->rxcount)
+#endif /* UIP_UDP_RXQ */
+
+#if UIP_IGMP
+/**
+ * Bind a UDP connection to a multicast group.
+ *
+ * The host joins the group, and the connection only takes datagrams
+ * that are sent to the group from then on. A connection that is not
+ * bound to a group takes datagrams sent to its port at any of our
+ * addresses, including the joined groups. The group is left when the
+ * connection is removed.
+ *
+ * \note The configuration parameter UIP_IGMP must be set for this
+ * function to be enabled.
+ *
+ * \param conn The UDP connection.
+ *
+ * \param group The multicast group.
+ *
+ * \return Non-zero if the group was joined, zero if too many groups
+ * are joined already.
+ */
+u8_t uip_udp_join(struct uip_udp_conn *conn, uip_ipaddr_t *group);
+
+/**
+ * Unbind a UDP connection from its multicast group.
+ *
+ * The host leaves the group unless it is still used elsewhere.
+ *
+ * \param conn The UDP connection.
+ */
+void uip_udp_leave(struct uip_udp_conn *conn);
+#endif /* UIP_IGMP */
+
+#if UIP_UDP_SENDMSG
+/**
+ * Send a UDP datagram on a connection right away.
+ *
+ * The datagram is built in uip_buf from the header template of the
+ * connection and handed to UIP_UDP_SENDMSG_OUTPUT() before the
+ * function returns, so the function can be called many times in a
+ * row. It may be called from the UIP_UDP_APPCALL() of any UDP
+ * connection, where it overwrites the incoming datagram, or outside
+ * of uIP, but not from the UIP_APPCALL() of a TCP connection. The
+ * data may be in uip_appdata, as for uip_udp_send().
+ *
+ * If UIP_IP_FRAG is set, a datagram that is too large for uip_buf is
+ * sent as IP fragments, each of which is handed to
+ * UIP_UDP_SENDMSG_OUTPUT(). The data must then not be in uip_buf.
+ *
+ * \note The configuration parameter UIP_UDP_SENDMSG must be set for
+ * this function to be enabled.
+ *
+ * \param conn The UDP connection.
+ *
+ * \param data The data of the datagram.
+ *
+ * \param len The length of the data.
+ *
+ * \return Non-zero if the datagram was sent, zero if it was too large
+ * or the connection is paced and may not send yet.
+ */
+u8_t uip_udp_sendmsg(struct uip_udp_conn *conn, const void *data,
+		     u16_t len);
+#endif /* UIP_UDP_SENDMSG */
+
 /** @} */
 
 /* uIP convenience and converting functions. 
@@ -1151,6 +1849,47 @@ struct uip_udp_conn *uip_udp_new(uip_ipaddr_t *ripaddr, u16_t rport);
  */
 #define uip_ipaddr4(addr) (htons(((u16_t *)(addr))[1]) & 0xff)
 
+/**
+ * Check if an IPv4 address is a multicast address (224.0.0.0/4).
+ *
+ * \hideinitializer
+ */
+#define uip_ipaddr_mcast(addr) ((((u8_t *)(addr))[0] & 0xf0) == 0xe0)
+
+#if UIP_DUAL_STACK
+/**
+ * Construct the IPv4-mapped IPv6 address (::ffff:a.b.c.d) of an IPv4
+ * address.
+ *
+ * In a dual-stack build, IPv4 hosts are addressed through their
+ * IPv4-mapped addresses:
+ \code
+ uip_ipaddr_t ipaddr;
+ struct uip_conn *c;
+
+ uip_ip4addr(&ipaddr, 192,168,1,2);
+ c = uip_connect(&ipaddr, HTONS(80));
+ \endcode
+ *
+ * \hideinitializer
+ */
+#define uip_ip4addr(addr, addr0,addr1,addr2,addr3) \
+        uip_ip6addr(addr, 0,0,0,0,0,0xffff, \
+                    ((addr0) << 8) | (addr1), ((addr2) << 8) | (addr3))
+
+/**
+ * Check if an address is an IPv4-mapped address.
+ *
+ * \hideinitializer
+ */
+#define uip_ipaddr_is4(addr) (((u16_t *)(addr))[0] == 0 && \
+                              ((u16_t *)(addr))[1] == 0 && \
+                              ((u16_t *)(addr))[2] == 0 && \
+                              ((u16_t *)(addr))[3] == 0 && \
+                              ((u16_t *)(addr))[4] == 0 && \
+                              ((u16_t *)(addr))[5] == 0xffff)
+#endif /* UIP_DUAL_STACK */
+
 /**
  * Convert 16-bit quantity from host byte order to network byte order.
  	16λִֽ˳תΪֽ˳
@@ -1252,6 +1991,20 @@ extern u16_t uip_urglen, uip_surglen;
 #endif /* UIP_URGDATA > 0 */
 
 
+#if UIP_PACING
+/**
+ * A token bucket that limits the transmit rate of a connection.
+ */
+struct uip_pacer {
+  u16_t rate;                /**< Bytes per clock tick, or zero if the
+				connection is not paced. */
+  u16_t burst;               /**< The size of the bucket. */
+  short tokens;              /**< Bytes that may be sent right now. */
+  clock_time_t stamp;        /**< When the bucket was last refilled. */
+  u8_t held;                 /**< Set when TCP data is held back. */
+};
+#endif /* UIP_PACING */
+
 /**
  * Representation of a uIP TCP connection.
  	ʾһTCP
@@ -1293,6 +2046,82 @@ struct uip_conn {
   /* һط*/
   u8_t nrtx;          /**< The number of retransmissions for the last
 			 segment sent. һĶشĴ*/
+#if UIP_CONN_POOL
+  struct uip_conn *nextfree; /**< Next connection on the free list. */
+  struct uip_conn *hnext;    /**< Next connection in the same hash
+				bucket by local port, remote port and
+				remote IP address. */
+  struct uip_conn *pnext;    /**< Next actively opened connection in
+				the same hash bucket by local port. */
+#endif /* UIP_CONN_POOL */
+#if UIP_TCP_TIMER_WHEEL
+  struct uip_conn *twnext;   /**< Next connection in the same timer
+				wheel slot. */
+  struct uip_conn **twpprev; /**< The pointer that points to this
+				connection in the timer wheel, or NULL. */
+  unsigned int twexpire;     /**< The tick at which the timer expires. */
+  u8_t twkind;               /**< The kind of timer that is running. */
+#endif /* UIP_TCP_TIMER_WHEEL */
+#if UIP_READY_LIST
+  struct uip_conn *rdnext;   /**< Next connection on the ready list. */
+  struct uip_conn **rdpprev; /**< The pointer that points to this
+				connection on the ready list, or NULL. */
+#endif /* UIP_READY_LIST */
+#if UIP_TCP_KEEPALIVE
+  u16_t kaidle;              /**< Idle ticks before the first keepalive
+				probe, or zero if keepalive is off. */
+  u16_t kaintvl;             /**< Ticks between keepalive probes. */
+  u16_t katimer;             /**< Ticks left until the next probe. */
+  u8_t kacnt;                /**< Unanswered probes before the
+				connection is dropped. */
+  u8_t kaprobes;             /**< Probes sent without an answer. */
+#endif /* UIP_TCP_KEEPALIVE */
+#if UIP_TCP_RXBUF
+  u8_t *rxbuf;               /**< The receive ring, or NULL. */
+  u16_t rxsize;              /**< The size of the receive ring. */
+  u16_t rxstart;             /**< Offset of the first unread byte. */
+  u16_t rxlen;               /**< Number of unread bytes in the ring. */
+  u16_t rxwnd;               /**< The window last advertised. */
+#endif /* UIP_TCP_RXBUF */
+#if UIP_TCP_TXBUF
+  u8_t *txbuf;               /**< The send ring, or NULL. */
+  u16_t txsize;              /**< The size of the send ring. */
+  u16_t txstart;             /**< Offset of the first unacknowledged
+				byte. */
+  u16_t txlen;               /**< Number of queued bytes in the ring,
+				including those in transit. */
+  u8_t txclose;              /**< Set when the application has closed
+				the connection while data was queued. */
+#endif /* UIP_TCP_TXBUF */
+#if UIP_PACING
+  struct uip_pacer pacer;    /**< The transmit rate of the
+				connection. */
+#endif /* UIP_PACING */
+#if UIP_TCP_PERSIST
+  u8_t persist;              /**< Non-zero while the window of the
+				remote host is closed; the backoff of
+				the window probes. */
+#endif /* UIP_TCP_PERSIST */
+#if UIP_TCP_FASTOPEN
+  u8_t fastopen;             /**< TCP Fast Open state of the handshake. */
+#endif /* UIP_TCP_FASTOPEN */
+#if UIP_TCP_TLP
+  u8_t probed;               /**< Set when the data in transit has been
+				retransmitted by a tail loss probe or
+				RACK. */
+#endif /* UIP_TCP_TLP */
+#if UIP_LSO
+  u16_t wnd;                 /**< The window advertised by the remote
+				host. */
+#endif /* UIP_LSO */
+#if UIP_TCP_ECN
+  u8_t ecn;                  /**< ECN state of the connection. */
+  u16_t cwnd;                /**< The congestion window, in bytes. */
+#if UIP_TCP_ECN_DCTCP
+  u16_t alpha;               /**< The fraction of segments that have
+				been marked, times 1024. */
+#endif /* UIP_TCP_ECN_DCTCP */
+#endif /* UIP_TCP_ECN */
 
   /** The application state. û״̬ʶ*/
   uip_tcp_appstate_t appstate;
@@ -1309,7 +2138,40 @@ struct uip_conn {
 extern struct uip_conn *uip_conn;
 /* The array containing all uIP connections. 
 	еUIPЭջӣĬΪ40*/
+#if UIP_CONN_POOL
+extern struct uip_conn *uip_conns;
+/* The number of connections in uip_conns that have been taken into
+   use. UIP_CONNS evaluates to this when the pool is used. */
+extern unsigned int uip_conns_num;
+#undef UIP_CONNS
+#define UIP_CONNS uip_conns_num
+
+/**
+ * Give uIP the memory for its TCP connection pool.
+ *
+ * This function hands uIP a block of memory that is large enough to
+ * hold limit uip_conn structures. uIP initializes and takes
+ * connections into use UIP_CONN_POOL_SLAB at a time, as they are
+ * needed, so the memory may be reserved lazily by the system (e.g.,
+ * an anonymous mmap() on Linux) and is only touched when the number
+ * of concurrent connections grows.
+ *
+ * Example:
+ \code
+ static struct uip_conn conns[1000];
+
+ uip_init();
+ uip_conn_pool_init(conns, 1000);
+ \endcode
+ *
+ * \param mem A pointer to memory for limit uip_conn structures.
+ *
+ * \param limit The maximum number of TCP connections.
+ */
+void uip_conn_pool_init(struct uip_conn *mem, unsigned int limit);
+#else /* UIP_CONN_POOL */
 extern struct uip_conn uip_conns[UIP_CONNS];
+#endif /* UIP_CONN_POOL */
 /**
  * \addtogroup uiparch
  * @{
@@ -1334,6 +2196,40 @@ struct uip_udp_conn {
   u16_t lport;        /**< The local port number in network byte order. ض˿ںţʹֽ˳*/
   u16_t rport;        /**< The remote port number in network byte order. Զ˿ںţʹֽ˳*/
   u8_t  ttl;          /**< Default time-to-live. Ĭʱ*/
+#if UIP_CONN_POOL
+  struct uip_udp_conn *nextfree; /**< Next connection on the free
+				     list. */
+#endif /* UIP_CONN_POOL */
+#if UIP_PACING
+  struct uip_pacer pacer;   /**< The transmit rate of the connection. */
+#endif /* UIP_PACING */
+#if UIP_UDP_RXQ
+  u8_t *rxbuf;               /**< The receive queue, or NULL. */
+  u16_t rxsize;              /**< Size of the receive queue. */
+  u16_t rxstart;             /**< Offset of the oldest datagram. */
+  u16_t rxlen;               /**< Number of bytes in the queue. */
+  u16_t rxcount;             /**< Number of datagrams in the queue. */
+#endif /* UIP_UDP_RXQ */
+#if UIP_IGMP
+  uip_ipaddr_t group;        /**< The multicast group that the
+				connection is bound to, or zero. */
+#endif /* UIP_IGMP */
+#if UIP_UDP_SENDMSG
+#if UIP_CONF_IPV6
+  u16_t hdr[24];             /**< IP and UDP header template. */
+#else /* UIP_CONF_IPV6 */
+  u16_t hdr[14];             /**< IP and UDP header template. */
+  u16_t ipsum;               /**< Checksum of the IP header template. */
+#endif /* UIP_CONF_IPV6 */
+  u16_t udpsum;              /**< Checksum of the UDP pseudo header
+				and ports of the template. */
+#endif /* UIP_UDP_SENDMSG */
+#if UIP_UDP_HASH
+  struct uip_udp_conn *pnext; /**< Next connection in the same bucket
+				 of the local port hash table. */
+  struct uip_udp_conn *cnext; /**< Next connection in the same bucket
+				 of the remote host hash table. */
+#endif /* UIP_UDP_HASH */
 
   /** The application state. Ӧó״̬ǩ*/
   uip_udp_appstate_t appstate;
@@ -1343,7 +2239,25 @@ struct uip_udp_conn {
  * The current UDP connection. ǰ
  */
 extern struct uip_udp_conn *uip_udp_conn;
+#if UIP_CONN_POOL
+extern struct uip_udp_conn *uip_udp_conns;
+extern unsigned int uip_udp_conns_num;
+#undef UIP_UDP_CONNS
+#define UIP_UDP_CONNS uip_udp_conns_num
+
+/**
+ * Give uIP the memory for its UDP connection pool.
+ *
+ * The UDP counterpart of uip_conn_pool_init().
+ *
+ * \param mem A pointer to memory for limit uip_udp_conn structures.
+ *
+ * \param limit The maximum number of UDP connections.
+ */
+void uip_udp_conn_pool_init(struct uip_udp_conn *mem, unsigned int limit);
+#else /* UIP_CONN_POOL */
 extern struct uip_udp_conn uip_udp_conns[UIP_UDP_CONNS];
+#endif /* UIP_CONN_POOL */
 #endif /* UIP_UDP */
 
 /**
@@ -1402,6 +2316,10 @@ struct uip_stats {
     uip_stats_t drop;     /**< Number of dropped UDP segments. */
     uip_stats_t chkerr;   /**< Number of UDP segments with a bad
 			     checksum. */
+#if UIP_UDP_RXQ
+    uip_stats_t qdrop;    /**< Number of UDP segments dropped because
+			     the receive queue was full. */
+#endif /* UIP_UDP_RXQ */
   } udp;                  /**< UDP statistics. */
 #endif /* UIP_UDP */
 };
@@ -1502,6 +2420,10 @@ void uip_process(u8_t flag);
 #if UIP_UDP
 #define UIP_UDP_TIMER     5
 #endif /* UIP_UDP */
+#if UIP_IGMP
+#define UIP_IGMP_TIMER    6     /* Tells uIP that the IGMP timer has
+				   fired. */
+#endif /* UIP_IGMP */
 
 /* The TCP states used in the uip_conn->tcpstateflags. */
 #define UIP_CLOSED      0
@@ -1644,6 +2566,7 @@ struct uip_udpip_hdr {
 
 
 #define UIP_PROTO_ICMP  1
+#define UIP_PROTO_IGMP  2
 #define UIP_PROTO_TCP   6
 #define UIP_PROTO_UDP   17
 #define UIP_PROTO_ICMP6 58
@@ -1671,6 +2594,14 @@ extern const uip_ipaddr_t uip_hostaddr, uip_netmask, uip_draddr;
 extern uip_ipaddr_t uip_hostaddr, uip_netmask, uip_draddr;
 #endif /* UIP_FIXEDADDR */
 
+#if UIP_DUAL_STACK
+extern uip_ipaddr_t uip_hostaddr4, uip_draddr4, uip_netmask4;
+#endif /* UIP_DUAL_STACK */
+
+#if UIP_RUNTIME_MTU
+extern u16_t uip_mtu;
+#endif /* UIP_RUNTIME_MTU */
+
 
 
 /**
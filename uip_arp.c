@@ -115,6 +115,34 @@ static u8_t tmpage;
 
 #define BUF   ((struct arp_hdr *)&uip_buf[0])
 #define IPBUF ((struct ethip_hdr *)&uip_buf[0])
+
+/* ARP deals with 32-bit IPv4 addresses, while uip_ipaddr_t is an IPv6
+   address in IPv6 builds, so the addresses are handled as two 16-bit
+   words here. */
+#define arp_ipaddr_copy(dest, src) do { \
+                     ((u16_t *)(dest))[0] = ((u16_t *)(src))[0]; \
+                     ((u16_t *)(dest))[1] = ((u16_t *)(src))[1]; \
+                  } while(0)
+#define arp_ipaddr_cmp(addr1, addr2) \
+  (((u16_t *)(addr1))[0] == ((u16_t *)(addr2))[0] && \
+   ((u16_t *)(addr1))[1] == ((u16_t *)(addr2))[1])
+#define arp_ipaddr_maskcmp(addr1, addr2, mask) \
+  (((((u16_t *)(addr1))[0] & ((u16_t *)(mask))[0]) == \
+    (((u16_t *)(addr2))[0] & ((u16_t *)(mask))[0])) && \
+   ((((u16_t *)(addr1))[1] & ((u16_t *)(mask))[1]) == \
+    (((u16_t *)(addr2))[1] & ((u16_t *)(mask))[1])))
+
+#if UIP_DUAL_STACK
+/* The IPv4 address is in the last 32 bits of an IPv4-mapped
+   address. */
+#define ARP_HOSTADDR (&uip_hostaddr4[6])
+#define ARP_NETMASK  (&uip_netmask4[6])
+#define ARP_DRADDR   (&uip_draddr4[6])
+#else /* UIP_DUAL_STACK */
+#define ARP_HOSTADDR uip_hostaddr
+#define ARP_NETMASK  uip_netmask
+#define ARP_DRADDR   uip_draddr
+#endif /* UIP_DUAL_STACK */
 /*-----------------------------------------------------------------------------------*/
 /**
  * Initialize the ARP module.
@@ -301,7 +329,7 @@ uip_arp_arpin(void)
   case HTONS(ARP_REQUEST):
     /* ARP request. If it asked for our address, we send out a
        reply. ARPģԷõǵIPַԷһظ*/
-    if(uip_ipaddr_cmp(BUF->dipaddr, uip_hostaddr)) {
+    if(arp_ipaddr_cmp(BUF->dipaddr, ARP_HOSTADDR)) {
       /* First, we register the one who made the request in our ARP
 	 table, since it is likely that we will do more communication
 	 with this host in the future. 
@@ -319,8 +347,7 @@ uip_arp_arpin(void)
       
       BUF->dipaddr[0] = BUF->sipaddr[0];
       BUF->dipaddr[1] = BUF->sipaddr[1];
-      BUF->sipaddr[0] = uip_hostaddr[0];
-      BUF->sipaddr[1] = uip_hostaddr[1];
+      arp_ipaddr_copy(BUF->sipaddr, ARP_HOSTADDR);
 
       BUF->ethhdr.type = HTONS(UIP_ETHTYPE_ARP);
       uip_len = sizeof(struct arp_hdr);
@@ -329,7 +356,7 @@ uip_arp_arpin(void)
   case HTONS(ARP_REPLY):
     /* ARP reply. We insert or update the ARP table if it was meant
        for us. յARPظģñǷ͸ǵģҪ»ARP*/
-    if(uip_ipaddr_cmp(BUF->dipaddr, uip_hostaddr)) {
+    if(arp_ipaddr_cmp(BUF->dipaddr, ARP_HOSTADDR)) {
       uip_arp_update(BUF->sipaddr, &BUF->shwaddr);
     }
     break;
@@ -391,26 +418,43 @@ uip_arp_out(void)
 
   /* First check if destination is a local broadcast. 
   		ȣĿĵַǷǱع㲥ַ*/
-  if(uip_ipaddr_cmp(IPBUF->destipaddr, broadcast_ipaddr)) {
+#if UIP_CONF_IPV6
+  if((IPBUF->vhl & 0xf0) == 0x60) {
+    /* IPv6 packets do not use ARP. Their link level header is left
+       to the IPv6 neighbor discovery. */
+    return;
+  }
+#endif /* UIP_CONF_IPV6 */
+  if(arp_ipaddr_cmp(IPBUF->destipaddr, broadcast_ipaddr)) {
     memcpy(IPBUF->ethhdr.dest.addr, broadcast_ethaddr.addr, 6);
+  } else if(uip_ipaddr_mcast(IPBUF->destipaddr)) {
+    /* An IP multicast group maps to the Ethernet multicast address
+       01:00:5e followed by the low 23 bits of the group, so no ARP
+       lookup is needed. */
+    IPBUF->ethhdr.dest.addr[0] = 0x01;
+    IPBUF->ethhdr.dest.addr[1] = 0x00;
+    IPBUF->ethhdr.dest.addr[2] = 0x5e;
+    IPBUF->ethhdr.dest.addr[3] = ((u8_t *)IPBUF->destipaddr)[1] & 0x7f;
+    IPBUF->ethhdr.dest.addr[4] = ((u8_t *)IPBUF->destipaddr)[2];
+    IPBUF->ethhdr.dest.addr[5] = ((u8_t *)IPBUF->destipaddr)[3];
   } else {
     /* Check if the destination address is on the local network. 
 		ĿĵַǷڱ*/
-    if(!uip_ipaddr_maskcmp(IPBUF->destipaddr, uip_hostaddr, uip_netmask)) {
+    if(!arp_ipaddr_maskcmp(IPBUF->destipaddr, ARP_HOSTADDR, ARP_NETMASK)) {
       /* Destination address was not on the local network, so we need to
 	 use the default router's IP address instead of the destination
 	 address when determining the MAC address. 
 	 		ĿĵַٱУҪʹĬ·ɵַĿĵַ
 			*/
-      uip_ipaddr_copy(ipaddr, uip_draddr);
+      arp_ipaddr_copy(ipaddr, ARP_DRADDR);
     } else {
       /* Else, we use the destination IP address. ʹĿIPַ*/
-      uip_ipaddr_copy(ipaddr, IPBUF->destipaddr);
+      arp_ipaddr_copy(ipaddr, IPBUF->destipaddr);
     }
       
     for(i = 0; i < UIP_ARPTAB_SIZE; ++i) {
       tabptr = &arp_table[i];
-      if(uip_ipaddr_cmp(ipaddr, tabptr->ipaddr)) {
+      if(arp_ipaddr_cmp(ipaddr, tabptr->ipaddr)) {
 	break;
       }
     }
@@ -425,8 +469,8 @@ uip_arp_out(void)
       memcpy(BUF->ethhdr.src.addr, uip_ethaddr.addr, 6);
       memcpy(BUF->shwaddr.addr, uip_ethaddr.addr, 6);
     
-      uip_ipaddr_copy(BUF->dipaddr, ipaddr);
-      uip_ipaddr_copy(BUF->sipaddr, uip_hostaddr);
+      arp_ipaddr_copy(BUF->dipaddr, ipaddr);
+      arp_ipaddr_copy(BUF->sipaddr, ARP_HOSTADDR);
       BUF->opcode = HTONS(ARP_REQUEST); /* ARP request. */
       BUF->hwtype = HTONS(ARP_HWTYPE_ETH);
       BUF->protocol = HTONS(UIP_ETHTYPE_IP);
@@ -169,16 +169,24 @@
  * 
  * uIP supports reassembly of fragmented IP packets. This features
  * requires an additonal amount of RAM to hold the reassembly buffer
- * and the reassembly code size is approximately 700 bytes.  The
- * reassembly buffer is of the same size as the uip_buf buffer
- * (configured by UIP_BUFSIZE).
+ * and the reassembly code size is approximately 700 bytes. Up to
+ * UIP_REASS_CONTEXTS datagrams are reassembled at the same time, in
+ * blocks taken from a pool of UIP_REASS_POOLSIZE bytes. A reassembled
+ * datagram must fit in the uip_buf buffer (configured by
+ * UIP_BUFSIZE). In IPv6 builds, the fragment extension header is
+ * reassembled by the same code. Without reassembly, fragments are
+ * dropped.
  * Эַ֧ɢipݰװҪĶڴ棬װĵĻԼװܴ飬Ҫ700ֽڵĶڴ档
  * ͨװСuip_bufá
  * \note IP packet reassembly is not heavily tested. ipݰװδϸ
  *
  * \hideinitializer
  */
+#ifdef UIP_CONF_REASSEMBLY
+#define UIP_REASSEMBLY UIP_CONF_REASSEMBLY
+#else /* UIP_CONF_REASSEMBLY */
 #define UIP_REASSEMBLY 0	//IPݰװع
+#endif /* UIP_CONF_REASSEMBLY */
 
 /**
  * The maximum time an IP fragment should wait in the reassembly
@@ -187,6 +195,80 @@
  */
 #define UIP_REASS_MAXAGE 40
 
+/**
+ * The number of datagrams that can be reassembled at the same time.
+ *
+ * When fragments of one more datagram arrive, the oldest unfinished
+ * datagram is dropped.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_REASS_CONTEXTS
+#define UIP_REASS_CONTEXTS UIP_CONF_REASS_CONTEXTS
+#else /* UIP_CONF_REASS_CONTEXTS */
+#define UIP_REASS_CONTEXTS 2
+#endif /* UIP_CONF_REASS_CONTEXTS */
+
+/**
+ * The size of the blocks that fragments are reassembled in.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_REASS_BLOCK
+#define UIP_REASS_BLOCK UIP_CONF_REASS_BLOCK
+#else /* UIP_CONF_REASS_BLOCK */
+#define UIP_REASS_BLOCK 128
+#endif /* UIP_CONF_REASS_BLOCK */
+
+/**
+ * The size of the pool of blocks that is shared by the datagrams
+ * being reassembled.
+ *
+ * A datagram takes as many blocks as its length needs. A datagram is
+ * dropped if it needs a block when the pool is empty.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_REASS_POOLSIZE
+#define UIP_REASS_POOLSIZE UIP_CONF_REASS_POOLSIZE
+#else /* UIP_CONF_REASS_POOLSIZE */
+#define UIP_REASS_POOLSIZE UIP_BUFSIZE
+#endif /* UIP_CONF_REASS_POOLSIZE */
+
+/**
+ * IPv4 fragmentation on output.
+ *
+ * When enabled, uip_udp_sendmsg() can send datagrams of up to 64
+ * kilobytes by splitting them into IP fragments that fit in uip_buf,
+ * and the forwarding module splits packets that are larger than the
+ * MTU of the outgoing network interface.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_IP_FRAG
+#define UIP_IP_FRAG UIP_CONF_IP_FRAG
+#else /* UIP_CONF_IP_FRAG */
+#define UIP_IP_FRAG 0
+#endif /* UIP_CONF_IP_FRAG */
+
+/**
+ * Dual-stack IPv4 and IPv6.
+ *
+ * When enabled in an IPv6 build (UIP_CONF_IPV6), uIP also accepts
+ * and sends IPv4 packets. An IPv4 peer is represented by its
+ * IPv4-mapped IPv6 address (::ffff:a.b.c.d, see uip_ip4addr()), so
+ * that both families share the connection tables, the demultiplexing
+ * and the TCP and UDP code. The IPv4 address of the host is set with
+ * uip_sethostaddr4().
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_DUAL_STACK
+#define UIP_DUAL_STACK UIP_CONF_DUAL_STACK
+#else /* UIP_CONF_DUAL_STACK */
+#define UIP_DUAL_STACK 0
+#endif /* UIP_CONF_DUAL_STACK */
+
 /** @} */
 
 /*------------------------------------------------------------------------------*/
@@ -232,6 +314,94 @@
 #define UIP_UDP_CONNS    10
 #endif /* UIP_CONF_UDP_CONNS */
 
+/**
+ * Hash based demultiplexing of UDP datagrams.
+ *
+ * When enabled, UDP connections are kept in two hash tables: one on
+ * the local port, and one on the local port, remote port and remote
+ * IP address for connections that are bound to a remote host. An
+ * incoming datagram is matched against the connections in the second
+ * table first, and then against those that share its local port,
+ * instead of against every UDP connection.
+ *
+ * The local port must then be set with uip_udp_bind() and the remote
+ * host with uip_udp_new(), and not by writing to the connection
+ * structure.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_UDP_HASH
+#define UIP_UDP_HASH UIP_CONF_UDP_HASH
+#else /* UIP_CONF_UDP_HASH */
+#define UIP_UDP_HASH 0
+#endif /* UIP_CONF_UDP_HASH */
+
+/**
+ * The number of buckets in each of the UDP hash tables.
+ *
+ * Must be a power of two.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_UDP_HASH_SIZE
+#define UIP_UDP_HASH_SIZE UIP_CONF_UDP_HASH_SIZE
+#else /* UIP_CONF_UDP_HASH_SIZE */
+#define UIP_UDP_HASH_SIZE 16
+#endif /* UIP_CONF_UDP_HASH_SIZE */
+
+/**
+ * Receive queues for UDP connections.
+ *
+ * When enabled, a UDP connection can be given a queue with
+ * uip_udp_rxq(). Datagrams for the connection are then stored in the
+ * queue instead of being handed to the application while they are in
+ * uip_buf, and the application reads them in batches with
+ * uip_udp_recv() when it is ready to.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_UDP_RXQ
+#define UIP_UDP_RXQ UIP_CONF_UDP_RXQ
+#else /* UIP_CONF_UDP_RXQ */
+#define UIP_UDP_RXQ 0
+#endif /* UIP_CONF_UDP_RXQ */
+
+/**
+ * Sending of several UDP datagrams at a time.
+ *
+ * When enabled, an application can send any number of datagrams on a
+ * UDP connection with uip_udp_sendmsg(), from its UIP_UDP_APPCALL()
+ * or from anywhere else, instead of only the one datagram that
+ * uip_udp_send() allows per call. The IP and UDP headers of each
+ * connection are kept in a template, so only the lengths and
+ * checksums have to be filled in for each datagram.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_UDP_SENDMSG
+#define UIP_UDP_SENDMSG UIP_CONF_UDP_SENDMSG
+#else /* UIP_CONF_UDP_SENDMSG */
+#define UIP_UDP_SENDMSG 0
+#endif /* UIP_CONF_UDP_SENDMSG */
+
+/**
+ * The function that sends out the datagrams of uip_udp_sendmsg().
+ *
+ * The function takes no arguments and must send the packet in
+ * uip_buf, with length uip_len, in the same way as the main loop
+ * does when uip_process() returns with uip_len > 0 (e.g., by calling
+ * uip_arp_out() before handing the packet to the network device). It
+ * can queue the packet with uip_tx_queue() so that a run of
+ * datagrams reaches the device in one batch.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_UDP_SENDMSG_OUTPUT
+#define UIP_UDP_SENDMSG_OUTPUT UIP_CONF_UDP_SENDMSG_OUTPUT
+#else /* UIP_CONF_UDP_SENDMSG_OUTPUT */
+#define UIP_UDP_SENDMSG_OUTPUT tcpip_output
+#endif /* UIP_CONF_UDP_SENDMSG_OUTPUT */
+
 /**
  * The name of the function that should be called when UDP datagrams arrive.
  * UDPݰʱӦ
@@ -256,7 +426,11 @@
  *
  * \hideinitializer
  */
+#ifdef UIP_CONF_ACTIVE_OPEN
+#define UIP_ACTIVE_OPEN UIP_CONF_ACTIVE_OPEN
+#else /* UIP_CONF_ACTIVE_OPEN */
 #define UIP_ACTIVE_OPEN 0	/*Ƿ*/
+#endif /* UIP_CONF_ACTIVE_OPEN */
 
 /**
  * The maximum number of simultaneously open TCP connections. ͬʱTCPӵֵ
@@ -274,6 +448,61 @@
 #define UIP_CONNS UIP_CONF_MAX_CONNECTIONS
 #endif /* UIP_CONF_MAX_CONNECTIONS */
 
+/**
+ * Allocate TCP and UDP connections from a runtime-sized pool.
+ *
+ * If this option is set, the uip_conns and uip_udp_conns tables are
+ * no longer statically allocated arrays of UIP_CONNS and
+ * UIP_UDP_CONNS entries. Instead, the application hands uIP a block
+ * of memory and an upper limit at initialization time by calling
+ * uip_conn_pool_init() and uip_udp_conn_pool_init(). uIP takes
+ * connections into use one slab at a time as they are needed, and
+ * closed connections are recycled through a free list.
+ *
+ * UIP_CONNS and UIP_UDP_CONNS then evaluate to the number of
+ * connections that have been taken into use so far, which means that
+ * loops like for(i = 0; i < UIP_CONNS; ++i) uip_periodic(i); keep
+ * working unmodified.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CONN_POOL
+#define UIP_CONN_POOL UIP_CONF_CONN_POOL
+#else /* UIP_CONF_CONN_POOL */
+#define UIP_CONN_POOL 0
+#endif /* UIP_CONF_CONN_POOL */
+
+/**
+ * The number of connections by which the connection pool grows.
+ *
+ * When the free list of the connection pool runs empty, this many
+ * connections are initialized and added to the free list, until the
+ * limit given to uip_conn_pool_init() is reached.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CONN_POOL_SLAB
+#define UIP_CONN_POOL_SLAB UIP_CONF_CONN_POOL_SLAB
+#else /* UIP_CONF_CONN_POOL_SLAB */
+#define UIP_CONN_POOL_SLAB 64
+#endif /* UIP_CONF_CONN_POOL_SLAB */
+
+/**
+ * The size of the hash tables that TCP connections in the connection
+ * pool are kept in. Incoming segments are matched to their connection
+ * through a table by local port, remote port and remote IP address,
+ * and uip_connect() finds a free local port through a table of the
+ * actively opened connections by local port, so that neither scans
+ * the pool. Must be a power of two.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CONN_POOL_HASH_SIZE
+#define UIP_CONN_POOL_HASH_SIZE UIP_CONF_CONN_POOL_HASH_SIZE
+#else /* UIP_CONF_CONN_POOL_HASH_SIZE */
+#define UIP_CONN_POOL_HASH_SIZE 256
+#endif /* UIP_CONF_CONN_POOL_HASH_SIZE */
+
 
 /**
  * The maximum number of simultaneously listening TCP ports. ͬʱTCP˿ڵֵ
@@ -326,10 +555,13 @@
 /**
  * The TCP maximum segment size.
  * TCPС
+ * It follows the MTU, so with UIP_RUNTIME_MTU it changes when
+ * uip_setmtu() is called.
+ *
  * This is should not be to set to more than
  * UIP_BUFSIZE - UIP_LLH_LEN - UIP_TCPIP_HLEN. ҪóСֵ 
  */
-#define UIP_TCP_MSS     (UIP_BUFSIZE - UIP_LLH_LEN - UIP_TCPIP_HLEN)
+#define UIP_TCP_MSS     (UIP_MTU - UIP_TCPIP_HLEN)
 
 /**
  * The size of the advertised receiver's window.
@@ -354,6 +586,543 @@
  */
 #define UIP_TIME_WAIT_TIMEOUT 120
 
+/**
+ * Drive the TCP timers from a timer wheel.
+ *
+ * Without this option, the periodic timer must call uip_periodic()
+ * for every connection on every tick, even for connections that have
+ * nothing to time out. With the timer wheel, uIP keeps track of the
+ * tick at which each connection's retransmission or TIME_WAIT timer
+ * expires, and the periodic timer only calls uip_wheel_tick() and
+ * then uip_periodic_conn() for the connections returned by
+ * uip_wheel_expired(). Idle connections cost nothing per tick.
+ *
+ * \note Connections are not polled periodically when the timer wheel
+ * is used. Use uip_poll_conn() to have the application polled.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_TIMER_WHEEL
+#define UIP_TCP_TIMER_WHEEL UIP_CONF_TCP_TIMER_WHEEL
+#else /* UIP_CONF_TCP_TIMER_WHEEL */
+#define UIP_TCP_TIMER_WHEEL 0
+#endif /* UIP_CONF_TCP_TIMER_WHEEL */
+
+/**
+ * The number of slots in the TCP timer wheel.
+ *
+ * Must be a power of two. With 256 slots, no TCP timer is longer
+ * than one turn of the wheel, so every connection found in the
+ * current slot has expired.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_TIMER_WHEEL_SIZE
+#define UIP_TCP_TIMER_WHEEL_SIZE UIP_CONF_TCP_TIMER_WHEEL_SIZE
+#else /* UIP_CONF_TCP_TIMER_WHEEL_SIZE */
+#define UIP_TCP_TIMER_WHEEL_SIZE 256
+#endif /* UIP_CONF_TCP_TIMER_WHEEL_SIZE */
+
+/**
+ * Only poll connections that have been marked as ready to send.
+ *
+ * Without this option, the periodic timer polls the application for
+ * every established connection that has no outstanding data, whether
+ * or not the application has anything to send. With this option, the
+ * application marks a connection with uip_conn_ready() when it has
+ * data to send, and only the marked connections are polled. The
+ * marked connections are fetched in round-robin order with
+ * uip_ready_next() and polled with uip_poll_conn().
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_READY_LIST
+#define UIP_READY_LIST UIP_CONF_READY_LIST
+#else /* UIP_CONF_READY_LIST */
+#define UIP_READY_LIST 0
+#endif /* UIP_CONF_READY_LIST */
+
+/**
+ * The maximum number of ready connections that are polled per
+ * periodic timer tick.
+ *
+ * Connections that did not get their turn are polled first on the
+ * next tick.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_READY_BUDGET
+#define UIP_READY_BUDGET UIP_CONF_READY_BUDGET
+#else /* UIP_CONF_READY_BUDGET */
+#define UIP_READY_BUDGET 16
+#endif /* UIP_CONF_READY_BUDGET */
+
+/**
+ * Support for TCP keepalive.
+ *
+ * When a connection has received nothing from the remote host for
+ * UIP_TCP_KEEPALIVE_IDLE timer ticks, uIP sends keepalive probes
+ * every UIP_TCP_KEEPALIVE_INTVL ticks. If UIP_TCP_KEEPALIVE_CNT
+ * probes go unanswered, the connection is reset and the application
+ * is called with the UIP_TIMEDOUT flag. The values can be changed for
+ * a particular connection with uip_keepalive().
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_KEEPALIVE
+#define UIP_TCP_KEEPALIVE UIP_CONF_TCP_KEEPALIVE
+#else /* UIP_CONF_TCP_KEEPALIVE */
+#define UIP_TCP_KEEPALIVE 0
+#endif /* UIP_CONF_TCP_KEEPALIVE */
+
+/**
+ * The default number of timer ticks a connection may be idle before
+ * the first keepalive probe is sent.
+ *
+ * Zero means that keepalive is off for new connections until it is
+ * turned on with uip_keepalive().
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_KEEPALIVE_IDLE
+#define UIP_TCP_KEEPALIVE_IDLE UIP_CONF_TCP_KEEPALIVE_IDLE
+#else /* UIP_CONF_TCP_KEEPALIVE_IDLE */
+#define UIP_TCP_KEEPALIVE_IDLE 0
+#endif /* UIP_CONF_TCP_KEEPALIVE_IDLE */
+
+/**
+ * The default number of timer ticks between keepalive probes.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_KEEPALIVE_INTVL
+#define UIP_TCP_KEEPALIVE_INTVL UIP_CONF_TCP_KEEPALIVE_INTVL
+#else /* UIP_CONF_TCP_KEEPALIVE_INTVL */
+#define UIP_TCP_KEEPALIVE_INTVL 150
+#endif /* UIP_CONF_TCP_KEEPALIVE_INTVL */
+
+/**
+ * The default number of unanswered keepalive probes after which the
+ * connection is considered dead.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_KEEPALIVE_CNT
+#define UIP_TCP_KEEPALIVE_CNT UIP_CONF_TCP_KEEPALIVE_CNT
+#else /* UIP_CONF_TCP_KEEPALIVE_CNT */
+#define UIP_TCP_KEEPALIVE_CNT 9
+#endif /* UIP_CONF_TCP_KEEPALIVE_CNT */
+
+/**
+ * Zero window probing with a persist timer.
+ *
+ * When the remote host advertises a zero window, data that the
+ * application sends is held back instead of being retransmitted into
+ * the closed window. The window is probed on a backoff schedule with
+ * segments that carry no data, and the held back data is sent as
+ * soon as the remote host opens its window again. The connection is
+ * aborted if UIP_MAXRTX probes in a row go unanswered.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_PERSIST
+#define UIP_TCP_PERSIST UIP_CONF_TCP_PERSIST
+#else /* UIP_CONF_TCP_PERSIST */
+#define UIP_TCP_PERSIST 0
+#endif /* UIP_CONF_TCP_PERSIST */
+
+/**
+ * Receive buffers for TCP connections.
+ *
+ * When enabled, the application can give a connection a ring buffer
+ * with uip_rxbuf(). Incoming data is then stored in the ring by uIP,
+ * and the application takes it out with uip_read() when it is ready
+ * to, also from outside of the application callback. The window that
+ * is advertised to the remote host is the free space in the ring.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_RXBUF
+#define UIP_TCP_RXBUF UIP_CONF_TCP_RXBUF
+#else /* UIP_CONF_TCP_RXBUF */
+#define UIP_TCP_RXBUF 0
+#endif /* UIP_CONF_TCP_RXBUF */
+
+/**
+ * Send buffers for TCP connections.
+ *
+ * When enabled, the application can give a connection a ring buffer
+ * with uip_txbuf() and queue data in it with uip_write(), also from
+ * outside of the application callback. uIP sends the queued data
+ * when the connection is polled, retransmits it without help from
+ * the application, and frees it when it is acknowledged.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_TXBUF
+#define UIP_TCP_TXBUF UIP_CONF_TCP_TXBUF
+#else /* UIP_CONF_TCP_TXBUF */
+#define UIP_TCP_TXBUF 0
+#endif /* UIP_CONF_TCP_TXBUF */
+
+/**
+ * Transmit pacing.
+ *
+ * When enabled, TCP and UDP connections can be given a rate with
+ * uip_pace() and uip_udp_pace(). The rate is enforced with a token
+ * bucket that is refilled from clock_time(). A TCP connection that is
+ * over its rate holds its data back until the bucket has refilled, a
+ * UDP connection is not polled until then, and large sends are split
+ * into bursts no larger than the bucket.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_PACING
+#define UIP_PACING UIP_CONF_PACING
+#else /* UIP_CONF_PACING */
+#define UIP_PACING 0
+#endif /* UIP_CONF_PACING */
+
+/**
+ * Header prediction for TCP input.
+ *
+ * When enabled, the connection of the last incoming segment is
+ * checked first when a segment is demultiplexed, and segments on an
+ * established connection that are either a pure ACK for the data in
+ * transit or the next in-order data segment are handed to the
+ * application without going through the general input processing
+ * (Van Jacobson's header prediction).
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_FASTPATH
+#define UIP_TCP_FASTPATH UIP_CONF_TCP_FASTPATH
+#else /* UIP_CONF_TCP_FASTPATH */
+#define UIP_TCP_FASTPATH 0
+#endif /* UIP_CONF_TCP_FASTPATH */
+
+/**
+ * Explicit Congestion Notification for TCP (RFC 3168).
+ *
+ * When enabled, uIP asks for ECN in the SYN of every connection and
+ * agrees to it when the remote host asks. On a connection that uses
+ * ECN, new data is sent ECN-capable, a Congestion Experienced mark
+ * from the network is echoed back with ECE, and an ECE from the
+ * remote host halves the congestion window and is answered with
+ * CWR. The congestion window limits the size of large sends (see
+ * UIP_LSO); a connection that sends a single segment at a time
+ * already has the smallest window there is.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_ECN
+#define UIP_TCP_ECN UIP_CONF_TCP_ECN
+#else /* UIP_CONF_TCP_ECN */
+#define UIP_TCP_ECN 0
+#endif /* UIP_CONF_TCP_ECN */
+
+/**
+ * DCTCP-style congestion response to ECN.
+ *
+ * When enabled together with UIP_TCP_ECN, every ACK echoes the mark
+ * of the segment that it acknowledges, and the congestion window is
+ * reduced in proportion to the fraction of marked segments instead of
+ * being halved, as in DCTCP (RFC 8257). This should only be used
+ * when both ends and the network in between are set up for DCTCP,
+ * such as within a data center.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_ECN_DCTCP
+#define UIP_TCP_ECN_DCTCP UIP_CONF_TCP_ECN_DCTCP
+#else /* UIP_CONF_TCP_ECN_DCTCP */
+#define UIP_TCP_ECN_DCTCP 0
+#endif /* UIP_CONF_TCP_ECN_DCTCP */
+
+/**
+ * Tail loss probes and time-based loss detection for TCP.
+ *
+ * When enabled, data in transit that has not been acknowledged
+ * within about two round-trip times is retransmitted once by a tail
+ * loss probe, without waiting for the retransmission timer and
+ * without backing it off. Data is also retransmitted at once when the
+ * remote host acknowledges only part of it more than a round-trip
+ * time after it was sent, as in RACK (RFC 8985). Duplicate ACKs and
+ * window updates do not count. No RTT sample is taken from the ACK of
+ * data that has been retransmitted this way. Both are driven by the
+ * periodic timer, so their resolution is that of the calls to
+ * uip_periodic().
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_TLP
+#define UIP_TCP_TLP UIP_CONF_TCP_TLP
+#else /* UIP_CONF_TCP_TLP */
+#define UIP_TCP_TLP 0
+#endif /* UIP_CONF_TCP_TLP */
+
+/**
+ * Support for TCP Fast Open (RFC 7413).
+ *
+ * A listening connection hands out a cookie to clients that ask for
+ * one, and accepts data in the SYN from clients that present a valid
+ * cookie. The application is then called with the UIP_CONNECTED and
+ * UIP_NEWDATA flags already in the SYN_RCVD state, and the data it
+ * sends in response goes out together with the SYNACK. The cookie is
+ * computed from the client's IP address with the key that is set with
+ * uip_fastopen_key(). Until the key has been set, no cookies are
+ * handed out and SYNs are handled as without Fast Open.
+ *
+ * If UIP_ACTIVE_OPEN is set, uip_connect() asks the server for a
+ * cookie, and caches the cookies it gets. When a cookie for the
+ * server is cached, the application is called with the UIP_CONNECTED
+ * flag before the SYN is sent, and the data it sends goes out in the
+ * SYN. When the SYNACK arrives, the application is called with
+ * UIP_ACKDATA if the server accepted the data, or with UIP_REXMIT if
+ * the data has to be sent again.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_FASTOPEN
+#define UIP_TCP_FASTOPEN UIP_CONF_TCP_FASTOPEN
+#else /* UIP_CONF_TCP_FASTOPEN */
+#define UIP_TCP_FASTOPEN 0
+#endif /* UIP_CONF_TCP_FASTOPEN */
+
+/**
+ * The number of servers for which uip_connect() caches a TCP Fast
+ * Open cookie.
+ *
+ * When the cache is full, the oldest cookie is replaced.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_FASTOPEN_CACHE
+#define UIP_TCP_FASTOPEN_CACHE UIP_CONF_TCP_FASTOPEN_CACHE
+#else /* UIP_CONF_TCP_FASTOPEN_CACHE */
+#define UIP_TCP_FASTOPEN_CACHE 4
+#endif /* UIP_CONF_TCP_FASTOPEN_CACHE */
+
+/**
+ * The number of connections that may have accepted data in the SYN
+ * and still wait for the ACK that completes the handshake.
+ *
+ * Further SYNs with data are handled as if the client had no cookie,
+ * so that a flood of them cannot take up all connections.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_FASTOPEN_PENDING
+#define UIP_TCP_FASTOPEN_PENDING UIP_CONF_TCP_FASTOPEN_PENDING
+#else /* UIP_CONF_TCP_FASTOPEN_PENDING */
+#define UIP_TCP_FASTOPEN_PENDING 4
+#endif /* UIP_CONF_TCP_FASTOPEN_PENDING */
+
+/**
+ * Path MTU discovery for TCP.
+ *
+ * TCP segments are sent with the Don't Fragment bit set, and an ICMP
+ * "fragmentation needed" message for a segment of one of our
+ * connections lowers the MSS of all connections to that host. The
+ * path MTU is remembered in a small table, so that new connections to
+ * the host start out with the right MSS. Routes with a known MTU,
+ * such as tunnels, can be entered with uip_pmtu_route(). Data that is
+ * in transit when the MSS is lowered keeps its length and is
+ * retransmitted in several segments, all but the last of which are
+ * sent with UIP_LSO_OUTPUT().
+ *
+ * Where the ICMP messages are filtered, a connection whose full-sized
+ * segment has timed out UIP_PMTU_BLACKHOLE_RTX times falls back to
+ * UIP_PMTU_BASE_MSS. Learned path MTUs expire after UIP_PMTU_MAXAGE
+ * calls to uip_pmtu_timer(), after which new connections probe the
+ * full MSS again.
+ *
+ * Only IPv4 is supported.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_PMTUD
+#define UIP_PMTUD UIP_CONF_PMTUD
+#else /* UIP_CONF_PMTUD */
+#define UIP_PMTUD 0
+#endif /* UIP_CONF_PMTUD */
+
+/**
+ * The number of entries in the path MTU table.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_PMTU_ENTRIES
+#define UIP_PMTU_ENTRIES UIP_CONF_PMTU_ENTRIES
+#else /* UIP_CONF_PMTU_ENTRIES */
+#define UIP_PMTU_ENTRIES 4
+#endif /* UIP_CONF_PMTU_ENTRIES */
+
+/**
+ * The time a learned path MTU is kept, in units of ten seconds.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_PMTU_MAXAGE
+#define UIP_PMTU_MAXAGE UIP_CONF_PMTU_MAXAGE
+#else /* UIP_CONF_PMTU_MAXAGE */
+#define UIP_PMTU_MAXAGE 60
+#endif /* UIP_CONF_PMTU_MAXAGE */
+
+/**
+ * The number of retransmissions of a full-sized segment after which
+ * the path is considered to drop large segments silently.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_PMTU_BLACKHOLE_RTX
+#define UIP_PMTU_BLACKHOLE_RTX UIP_CONF_PMTU_BLACKHOLE_RTX
+#else /* UIP_CONF_PMTU_BLACKHOLE_RTX */
+#define UIP_PMTU_BLACKHOLE_RTX 2
+#endif /* UIP_CONF_PMTU_BLACKHOLE_RTX */
+
+/**
+ * The MSS that is used on a path that drops large segments.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_PMTU_BASE_MSS
+#define UIP_PMTU_BASE_MSS UIP_CONF_PMTU_BASE_MSS
+#else /* UIP_CONF_PMTU_BASE_MSS */
+#define UIP_PMTU_BASE_MSS 536
+#endif /* UIP_CONF_PMTU_BASE_MSS */
+
+/**
+ * Large send offload in software.
+ *
+ * When enabled, an application can hand uIP more than one segment of
+ * data at a time with uip_send_large(). uIP splits the data into
+ * segments of at most the MSS of the connection and sends them in a
+ * burst from a single call to the stack, reusing the IP and TCP
+ * headers of the first segment for the rest. All but the last
+ * segment are sent with UIP_LSO_OUTPUT(); the last one is left in
+ * uip_buf to be sent by the caller in the normal way.
+ *
+ * The burst is acknowledged and retransmitted as a whole, just like a
+ * single segment.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_LSO
+#define UIP_LSO UIP_CONF_LSO
+#else /* UIP_CONF_LSO */
+#define UIP_LSO 0
+#endif /* UIP_CONF_LSO */
+
+/**
+ * The function that sends out the segments of a large send.
+ *
+ * It is also used for the segments of a retransmission that has to
+ * be split up because the MSS was lowered by path MTU discovery or
+ * uip_setmtu(), even if UIP_LSO is not set.
+ *
+ * The function takes no arguments and must send the packet in
+ * uip_buf, with length uip_len, in the same way as the main loop
+ * does when uip_process() returns with uip_len > 0 (e.g., by calling
+ * uip_arp_out() before handing the packet to the network device).
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_LSO_OUTPUT
+#define UIP_LSO_OUTPUT UIP_CONF_LSO_OUTPUT
+#else /* UIP_CONF_LSO_OUTPUT */
+#define UIP_LSO_OUTPUT tcpip_output
+#endif /* UIP_CONF_LSO_OUTPUT */
+
+/**
+ * Batched input with coalescing of in-order TCP segments.
+ *
+ * When enabled, a network device driver that receives several frames
+ * at a time can hand them all to uIP with uip_input_batch(). Runs of
+ * in-order TCP segments of the same connection that carry nothing
+ * but data and an ACK are merged into one segment before they are
+ * processed, so that the application is called once with all the
+ * data and a single ACK is sent for the whole run. The checksum of
+ * each segment is checked before it is merged.
+ *
+ * The segments of a connection are merged even if segments of other
+ * connections come between them, as long as they are within 32
+ * frames of each other. Segments are only merged for IPv4.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_INPUT_BATCH
+#define UIP_INPUT_BATCH UIP_CONF_INPUT_BATCH
+#else /* UIP_CONF_INPUT_BATCH */
+#define UIP_INPUT_BATCH 0
+#endif /* UIP_CONF_INPUT_BATCH */
+
+/**
+ * The function that sends out the packets produced by a batch of
+ * input.
+ *
+ * The function takes no arguments and must send the packet in
+ * uip_buf, with length uip_len, in the same way as the main loop
+ * does when uip_input() returns with uip_len > 0 (e.g., by calling
+ * uip_arp_out() before handing the packet to the network device).
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_BATCH_OUTPUT
+#define UIP_BATCH_OUTPUT UIP_CONF_BATCH_OUTPUT
+#else /* UIP_CONF_BATCH_OUTPUT */
+#define UIP_BATCH_OUTPUT tcpip_output
+#endif /* UIP_CONF_BATCH_OUTPUT */
+
+/**
+ * Batched transmission.
+ *
+ * When enabled, packets produced by uIP can be queued with
+ * uip_tx_queue() instead of being sent one at a time, and are handed
+ * to the device driver as one vector by uip_tx_flush(). This lets the
+ * driver ring its doorbell or make its system call once per batch
+ * instead of once per packet.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TX_BATCH
+#define UIP_TX_BATCH UIP_CONF_TX_BATCH
+#else /* UIP_CONF_TX_BATCH */
+#define UIP_TX_BATCH 0
+#endif /* UIP_CONF_TX_BATCH */
+
+/**
+ * The number of packets that can be queued for batched transmission.
+ *
+ * Each queued packet takes UIP_BUFSIZE bytes of RAM. When the queue
+ * is full it is flushed to the device driver.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TX_BATCH_SIZE
+#define UIP_TX_BATCH_SIZE UIP_CONF_TX_BATCH_SIZE
+#else /* UIP_CONF_TX_BATCH_SIZE */
+#define UIP_TX_BATCH_SIZE 4
+#endif /* UIP_CONF_TX_BATCH_SIZE */
+
+/**
+ * The function that sends a batch of packets.
+ *
+ * The function is called as UIP_TX_BATCH_OUTPUT(frames, n), where
+ * frames is an array of n struct uip_frame, and must send all of the
+ * frames, in order, before it returns (e.g., by placing them on the
+ * transmit ring of the network device and ringing its doorbell once,
+ * or with a single sendmmsg() call). The frames are reused after the
+ * function returns.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TX_BATCH_OUTPUT
+#define UIP_TX_BATCH_OUTPUT UIP_CONF_TX_BATCH_OUTPUT
+#else /* UIP_CONF_TX_BATCH_OUTPUT */
+#define UIP_TX_BATCH_OUTPUT tcpip_output_batch
+#endif /* UIP_CONF_TX_BATCH_OUTPUT */
+
 
 /** @} */
 /*------------------------------------------------------------------------------*/
@@ -397,8 +1166,9 @@
  * The size of the uIP packet buffer.
  * uipݰĴС
  * The uIP packet buffer should not be smaller than 60 bytes, and does
- * not need to be larger than 1500 bytes. Lower size results in lower
- * TCP throughput, larger size results in higher TCP throughput.
+ * not need to be larger than 1500 bytes unless jumbo frames are
+ * used. Lower size results in lower TCP throughput, larger size
+ * results in higher TCP throughput.
  * uipݰСӦС60ֽڣ1500ֽڣԽTCPԽ
  * \hideinitializer
  */
@@ -408,6 +1178,35 @@
 #define UIP_BUFSIZE UIP_CONF_BUFFER_SIZE
 #endif /* UIP_CONF_BUFFER_SIZE */
 
+/**
+ * Determines if the MTU can be set at run-time.
+ *
+ * With this option, UIP_BUFSIZE only sets the capacity of the packet
+ * buffer. The MTU, and the TCP MSS and receive window derived from
+ * it, are taken from the uip_mtu variable, which is set with
+ * uip_setmtu(). A single build can then serve both standard and jumbo
+ * frame links: UIP_BUFSIZE is configured for the largest frame and
+ * the MTU of the attached link is set when it comes up.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_RUNTIME_MTU
+#define UIP_RUNTIME_MTU UIP_CONF_RUNTIME_MTU
+#else /* UIP_CONF_RUNTIME_MTU */
+#define UIP_RUNTIME_MTU 0
+#endif /* UIP_CONF_RUNTIME_MTU */
+
+/**
+ * The largest IP packet that uIP sends.
+ *
+ * \hideinitializer
+ */
+#if UIP_RUNTIME_MTU
+#define UIP_MTU uip_mtu
+#else /* UIP_RUNTIME_MTU */
+#define UIP_MTU (UIP_BUFSIZE - UIP_LLH_LEN)
+#endif /* UIP_RUNTIME_MTU */
+
 
 /**
  * Determines if statistics support should be compiled in. Ƿֱ֧ͳͳƹ
@@ -452,6 +1251,49 @@
 #define UIP_BROADCAST UIP_CONF_BROADCAST
 #endif /* UIP_CONF_BROADCAST */
 
+/**
+ * IPv4 multicast reception with IGMP.
+ *
+ * When enabled, the host can join multicast groups with
+ * uip_igmp_join(), or by binding a UDP connection to a group with
+ * uip_udp_join(), and packets sent to the joined groups are
+ * accepted. Membership is reported to multicast routers with IGMPv3,
+ * or IGMPv2 when an IGMPv2 querier is present, and
+ * uip_igmp_periodic() must be called to send the reports. Only
+ * available for IPv4.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_IGMP
+#define UIP_IGMP UIP_CONF_IGMP
+#else /* UIP_CONF_IGMP */
+#define UIP_IGMP 0
+#endif /* UIP_CONF_IGMP */
+
+/**
+ * The maximum number of multicast groups that can be joined at the
+ * same time.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_IGMP_GROUPS
+#define UIP_IGMP_GROUPS UIP_CONF_IGMP_GROUPS
+#else /* UIP_CONF_IGMP_GROUPS */
+#define UIP_IGMP_GROUPS 4
+#endif /* UIP_CONF_IGMP_GROUPS */
+
+/**
+ * The time between calls to uip_igmp_periodic(), in tenths of a
+ * second.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_IGMP_TICK
+#define UIP_IGMP_TICK UIP_CONF_IGMP_TICK
+#else /* UIP_CONF_IGMP_TICK */
+#define UIP_IGMP_TICK 5
+#endif /* UIP_CONF_IGMP_TICK */
+
 /**
  * Print out a uIP log message.	ӡ־Ϣ
  *